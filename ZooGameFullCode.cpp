@@ -8,9 +8,38 @@
 #include <limits>
 #include <iomanip>
 #include <regex>
+#include <map>
 #include <unordered_map>
+#include <unordered_set>
+#include <list>
+#include <deque>
+#include <cstdint>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <iterator>
+#include <utility>
+#include <sstream>
+#include <functional>
+#include <cwchar>
+#include <array>
+#include <cmath>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <fstream>
+#include <filesystem>
+#include <string_view>
 #include <io.h>
 #include <fcntl.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#ifndef ENABLE_VIRTUAL_TERMINAL_PROCESSING
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#endif
+#endif
 
 using namespace std;
 
@@ -24,18 +53,68 @@ const int MAX_POPULARITY = 100;        // Максимальная популя
 const int MAX_AGE = 2000;              // Максимальный возраст животного
 const int OLD_AGE_THRESHOLD = 1000;    // Порог старости животного
 const int BREEDING_ENCLOSURE_COST = 800; // Стоимость вольера для размножения
+const int MAX_ENCLOSURE_LEVEL = 5;     // Максимальный уровень улучшения вольера
+const int DIRT_PER_DAY = 2;            // Прирост загрязнения вольера за день
+const int DIRT_CLEANING_THRESHOLD = 5; // Порог загрязнения, после которого нужна уборка
+const int TIMING_WHEEL_SLOTS = 64;     // Количество ячеек на одном уровне колеса таймеров
+const int SHOP_CACHE_SIZE = 4;         // Сколько выбранных животных магазина держать в кэше (snapshot идет мимо кэша)
+const int LIST_PAGE_SIZE = 10;         // Количество записей на одной странице списка
+const int BREEDING_AGE = 5;            // Возраст, после которого животное может размножаться
+const int BREEDING_BATCH_SIZE = 5;     // Максимум рождений за один день по плану
+const int BREEDING_SEARCH_WINDOW = 8;  // Сколько партнерок просматривается для каждого самца
+const int BREEDING_ENCLOSURE_BONUS = 500; // Бонус к оценке пары из вольера для размножения
+const int PEDIGREE_WEIGHT = 1000;      // Вес родства в оценке пары
+const int GENOME_MUTATION_ROUNDS = 5;  // Маска мутаций - AND стольких случайных слов (бит меняется с вероятностью 1/32)
+const int LIFESPAN_GENE_DAYS = 50;     // На сколько дней сдвигает порог старости каждая единица гена долголетия
+const int FERTILITY_BASE_CHANCE = 60;  // Шанс зачатия при нулевой плодовитости, %
+const int FERTILITY_GENE_PERCENT = 5;  // Прибавка к шансу зачатия за единицу гена плодовитости, %
+const int IMMUNE_RESISTANCE = 14;      // Устойчивость, при которой болезнь от соседей не передается
+const int COHORT_AGE_BUCKET = 30;      // Ширина возрастной группы стада в днях
+const int COHORT_INFECTION_PERCENT = 10; // Шанс заразиться за день для животного стада в вольере с больными, %
+const int COHORT_RECOVERY_PERCENT = 30;  // Шанс выздороветь за день для больного животного стада при ветеринаре, %
+const int BINOMIAL_EXACT_TRIALS = 32;  // До стольких испытаний биномиальная выборка считается точно
+const int BINOMIAL_NORMAL_MEAN = 10;   // С такого среднего числа успехов допустимо нормальное приближение
+const int VET_DAILY_PATIENTS = 10;     // Сколько животных вылечит за день ветеринар с эффективностью 100
+const int FOOD_PER_ANIMAL = 2;         // Дневная порция еды на одно животное
+const int FOOD_SHELF_LIFE = 10;        // Срок годности партии еды в днях
+const int FOOD_DELIVERY_DAYS = 2;      // Срок доставки оптового заказа еды
+const int BULK_FOOD_PRICE_PERCENT = 60; // Цена оптового заказа в процентах от обычной
+const int LEDGER_CHUNK_SIZE = 4096;    // Количество операций в одном блоке журнала
+const int VISITOR_STOPS = 4;           // Сколько вольеров обходит посетитель за визит
+const int VISITOR_BATCH = 1024;        // Размер пакета посетителей в симуляции
+const int NAME_ARENA_BLOCK_SIZE = 65536; // Размер блока памяти пула имен в байтах
+const int GENERATED_NAME_WORDS = 25;   // Количество основ сгенерированных имен животных
+const int METRICS_INTERVAL_SECONDS = 5; // Период записи файла метрик
+const int LATENCY_BUCKETS = 40;        // Корзины гистограммы длительности дня (степени двойки в мкс)
+const int STATUS_PANEL_LINES = 15;     // Высота закрепленной панели статуса в терминале
+const int REALTIME_DAY_MS = 1000;      // Длительность дня в режиме реального времени по умолчанию
+const int COMMAND_QUEUE_SIZE = 64;     // Емкость очереди команд игрока (степень двойки)
+const int REALTIME_LOG_SIZE = 5;       // Сколько последних сообщений показывать в режиме реального времени
+const int TASK_SLICE_MS = 20;          // Сколько фоновые задачи работают между проверками ввода
+const int TASK_PROGRESS_MS = 1000;     // Как часто выводится ход фоновых задач
+const int SPECIES_PER_TYPE = 5;        // Видов каждого типа в таблице видов
+const int SPECIES_COUNT = 25;          // Видов в таблице (номера 1-25, 0 - вид не задан)
 
 // Перечисления для типов данных
-enum class Diet { PREDATORS, HERBIVORES };    // Тип питания: хищники/травоядные
-enum class Climate { CONTINENT, TROPIC, ARCTIC }; // Климат: континентальный/тропический/арктический
+enum class Diet : unsigned { PREDATORS, HERBIVORES };    // Тип питания: хищники/травоядные
+enum class Climate : unsigned { CONTINENT, TROPIC, ARCTIC }; // Климат: континентальный/тропический/арктический
 enum class WorkerRole { DIRECTOR, VETERINAR, CLEANER, FOODMEN }; // Роли сотрудников
-enum class AnimalState { HEALTHY, SICK, DEAD }; // Состояния животных
+enum class AnimalState : unsigned { HEALTHY, SICK, DEAD }; // Состояния животных
+enum class AnimalSort { NONE, NAME, AGE, PRICE, HAPPINESS }; // Сортировка списка животных
+enum class ZooEventType { SALARY_PAYMENT, WORKER_REST, SHOP_REFRESH, ENCLOSURE_CLEANING, FOOD_DELIVERY }; // События планировщика
+enum class EnclosureKind { REGULAR, BREEDING }; // Виды вольеров
+enum class BreedingError { NONE, SAME_GENDER, TOO_YOUNG, NO_SPACE, NO_CONCEPTION }; // Результат проверки пары для размножения
+enum class LedgerCategory { SALARY, TICKETS, DIRT_PENALTY, ANIMAL_PURCHASE, ANIMAL_SALE, FOOD, ADVERTISING,
+    CONSTRUCTION, UPGRADE, ENCLOSURE_SALE, HIRING, SHOP_REFRESH, MARKET, UPKEEP, COUNT }; // Статьи доходов и расходов
+enum class PlayerCommandType { BUY_ANIMAL, BUY_FOOD, ORDER_FOOD, HIRE, BUILD, BREED, PAUSE, SPEED, STOP }; // Команды режима реального времени
+enum class MemoryTag { ANIMALS, ENCLOSURES, NAMES, SHOP, LEDGER, OTHER, COUNT }; // Подсистемы для учета памяти
 
 // Предварительные объявления структур
 struct Animal;
 struct Enclosure;
 struct Employee;
 struct Zoo;
+template <typename T> class CowVector;
 
 // Прототипы вспомогательных функций
 wstring chooseClimate();
@@ -43,95 +122,840 @@ wstring chooseAnimalType();
 wstring chooseSpecificAnimal(const wstring& type);
 bool isPredatorAnimal(const wstring& specificType);
 int calculateAnimalPrice(int age, int weight);
-void displayEnclosureInfo(int index, const vector<Enclosure>& enclosures);
+Animal generateShopAnimal(uint32_t seed);
+void displayEnclosureInfo(int index, const CowVector<Enclosure>& enclosures);
 void displayDelegationMessage(bool initial);
+const wchar_t* climateName(Climate climate);
+const wstring& speciesType(int species);
+const wstring& speciesName(int species);
+const wchar_t* stateName(AnimalState state);
+const wchar_t* breedingErrorText(BreedingError error);
+const wchar_t* foodName(Diet diet);
+const wchar_t* ledgerCategoryName(LedgerCategory category);
+const wchar_t* memoryTagName(MemoryTag tag);
+void displayMemoryReport();
 wstring removeNonRussian(const wstring& text);
 wstring localizeText(const wstring& text);
 wstring removeExtraSpaces(const wstring& text);
+bool parseNumber(const wstring& text, long long low, long long high, long long& value);
 
-// Класс Animal - представляет животное в зоопарке
-class Animal {
+// Структура GameRandom - детерминированный генератор случайных чисел (xorshift32).
+// Одинаковое зерно всегда дает одинаковую последовательность.
+struct GameRandom {
+    uint32_t state; // Текущее состояние генератора
+
+    explicit GameRandom(uint32_t seed) : state(seed ? seed : 0x9E3779B9u) {}
+
+    // Следующее случайное число
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // Случайное число в диапазоне [0, n)
+    int range(int n) {
+        return (int)(next() % (uint32_t)n);
+    }
+
+    // Число успехов в trials испытаниях с вероятностью percent% (биномиальная выборка).
+    // Малые выборки разыгрываются поштучно, выборки с малым средним - обращением функции
+    // распределения за O(среднего), остальные - нормальным приближением за O(1)
+    int binomial(int trials, int percent) {
+        if (trials <= 0 || percent <= 0) return 0;
+        if (percent >= 100) return trials;
+        if (trials <= BINOMIAL_EXACT_TRIALS) {
+            int successes = 0;
+            for (int i = 0; i < trials; i++) {
+                successes += range(100) < percent ? 1 : 0;
+            }
+            return successes;
+        }
+        // Считаем более редкий исход, чтобы малое среднее было и у успехов, и у неудач
+        if (percent > 50) return trials - binomial(trials, 100 - percent);
+
+        double probability = percent / 100.0;
+        double mean = trials * probability;
+        if (mean < BINOMIAL_NORMAL_MEAN) {
+            // Обращение: идем по вероятностям P(k) = P(k-1) * (n-k+1)/k * p/(1-p), пока не наберем u
+            double ratio = probability / (1.0 - probability);
+            double chance = pow(1.0 - probability, trials);
+            double uniform = next() / 4294967296.0;
+            int successes = 0;
+            while (uniform >= chance && successes < trials) {
+                uniform -= chance;
+                successes++;
+                chance *= ratio * (trials - successes + 1) / successes;
+            }
+            return successes;
+        }
+
+        double deviation = sqrt(mean * (1.0 - probability));
+        // Нормальная величина по Боксу-Мюллеру (first в (0, 1], чтобы логарифм был конечным)
+        double first = (next() + 1.0) / 4294967296.0;
+        double second = next() / 4294967296.0;
+        double normal = sqrt(-2.0 * log(first)) * cos(2.0 * 3.14159265358979323846 * second);
+        return (int)max(0.0, min((double)trials, round(mean + deviation * normal)));
+    }
+
+    // Смешивание зерна с номером (для получения независимых подпоследовательностей)
+    static uint32_t mix(uint32_t seed, uint32_t index) {
+        uint32_t x = seed + 0x9E3779B9u * (index + 1);
+        x = (x ^ (x >> 16)) * 0x85EBCA6Bu;
+        x = (x ^ (x >> 13)) * 0xC2B2AE35u;
+        return x ^ (x >> 16);
+    }
+};
+
+// Структура Genome - упакованный геном животного: 64 бита, четыре гена по 16 бит
+// (вес, долголетие, устойчивость к болезням, плодовитость). Значение признака - число
+// единичных битов в его гене (0-16), поэтому скрещивание, мутация и подсчет признаков
+// выполняются сразу для всех генов операциями над одним 64-битным словом.
+struct Genome {
+    enum Trait { WEIGHT, LIFESPAN, RESISTANCE, FERTILITY }; // Признаки (номер гена в слове)
+    static const int GENE_BITS = 16;                        // Длина одного гена
+
+    uint64_t bits = 0x00FF00FF00FF00FFull; // Гены (по умолчанию все признаки средние - 8 из 16)
+
+    // Случайное 64-битное слово
+    static uint64_t randomWord(GameRandom& random) {
+        uint64_t high = random.next();
+        return (high << 32) | random.next();
+    }
+
+    // Случайный геном (каждый бит - с вероятностью 1/2)
+    static Genome random(GameRandom& random) {
+        return { randomWord(random) };
+    }
+
+    // Геном потомка: каждый бит берется от случайного родителя (равномерный кроссовер),
+    // затем редкие биты инвертируются (в среднем 2 бита из 64)
+    static Genome cross(Genome first, Genome second, GameRandom& random) {
+        uint64_t mask = randomWord(random);
+        uint64_t child = (first.bits & mask) | (second.bits & ~mask);
+        uint64_t mutation = randomWord(random);
+        for (int i = 1; i < GENOME_MUTATION_ROUNDS; i++) {
+            mutation &= randomWord(random);
+        }
+        return { child ^ mutation };
+    }
+
+    // Число единиц в каждом 16-битном гене (параллельный подсчет битов внутри слова)
+    static uint64_t geneCounts(uint64_t x) {
+        x = x - ((x >> 1) & 0x5555555555555555ull);
+        x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+        return (x + (x >> 8)) & 0x00FF00FF00FF00FFull;
+    }
+
+    // Значение признака (0-16)
+    int trait(Trait gene) const {
+        return (int)((geneCounts(bits) >> (gene * GENE_BITS)) & 0xFF);
+    }
+};
+
+// Класс MemoryTracker - учет памяти по подсистемам: живые байты, число выделений и пик.
+// Счетчики общие для процесса и атомарные, так как зоопарки мира работают в нескольких потоках.
+class MemoryTracker {
 public:
-    // Основные атрибуты животного (вариант 1 - для английской версии)
-    string name;        // Имя животного
-    int age = 0;        // Возраст в днях
-    int weight = 0;     // Вес в кг
-    int price = 0;      // Цена животного
-    Diet diet;          // Тип питания (хищник/травоядное)
-    Climate climate;    // Предпочитаемый климат
-    AnimalState state;  // Состояние здоровья
-    int id = 0;         // Уникальный идентификатор
-
-    // Дополнительные атрибуты (вариант 2 - для локализованной версии)
-    wstring wname;      // Имя животного (unicode)
-    wstring type;       // Общий тип (кошачьи, псовые и т.д.)
-    wstring specificType; // Конкретный вид (лев, тигр и т.д.)
-    bool isPredator = false; // Является ли хищником
-    bool isSick = false;     // Болен ли
-    bool isHungry = false;   // Голоден ли
-    bool isUnhappy = false;  // Несчастлив ли
-    int happiness = 50;      // Уровень счастья (0-100)
-    wchar_t gender = 'M';    // Пол ('M' или 'F')
-    Animal* parent1 = nullptr; // Указатель на первого родителя
-    Animal* parent2 = nullptr; // Указатель на второго родителя
-    bool bornInZoo = false;  // Родилось ли в зоопарке
+    // Счетчики одной подсистемы
+    struct Counters {
+        atomic<long long> liveBytes{ 0 };   // Занято сейчас
+        atomic<long long> allocations{ 0 }; // Всего выделений
+        atomic<long long> peakBytes{ 0 };   // Наибольшее занятое значение
+    };
 
-    // Конструктор с параметрами
-    Animal(string _name, int _age, int _weight, int _price, Diet _diet, Climate _climate, AnimalState _state, int _id) :
-        name(_name), age(_age), weight(_weight), price(_price), diet(_diet), climate(_climate), state(_state), id(_id),
-        parent1(nullptr), parent2(nullptr), bornInZoo(false) {
+    static Counters& of(MemoryTag tag) {
+        static Counters counters[(int)MemoryTag::COUNT];
+        return counters[(int)tag];
     }
 
-    // Конструктор по умолчанию
-    Animal() : parent1(nullptr), parent2(nullptr), bornInZoo(false) {}
+    static void allocated(MemoryTag tag, size_t bytes) {
+        Counters& counters = of(tag);
+        counters.allocations.fetch_add(1, memory_order_relaxed);
+        long long live = counters.liveBytes.fetch_add((long long)bytes, memory_order_relaxed) + (long long)bytes;
+        long long peak = counters.peakBytes.load(memory_order_relaxed);
+        while (live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {
+        }
+    }
 
-    // Метод обновления состояния животного
-    void update() {
-        // Случайное заболевание животного с вероятностью 10%
-        if (rand() % 10 == 0) {
-            state = AnimalState::SICK;
+    static void released(MemoryTag tag, size_t bytes) {
+        of(tag).liveBytes.fetch_sub((long long)bytes, memory_order_relaxed);
+    }
+};
+
+// Шаблон TrackingAllocator - аллокатор для контейнеров, который учитывает память в подсистеме Tag
+template <typename T, MemoryTag Tag>
+struct TrackingAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = TrackingAllocator<U, Tag>;
+    };
+
+    TrackingAllocator() = default;
+
+    template <typename U>
+    TrackingAllocator(const TrackingAllocator<U, Tag>&) {}
+
+    T* allocate(size_t count) {
+        MemoryTracker::allocated(Tag, count * sizeof(T));
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* pointer, size_t count) {
+        MemoryTracker::released(Tag, count * sizeof(T));
+        ::operator delete(pointer);
+    }
+
+    template <typename U>
+    bool operator==(const TrackingAllocator<U, Tag>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const TrackingAllocator<U, Tag>&) const { return false; }
+};
+
+// Вектор, память которого учитывается в подсистеме Tag
+template <typename T, MemoryTag Tag>
+using TrackedVector = vector<T, TrackingAllocator<T, Tag>>;
+
+// Подсистема, к которой относятся элементы CowVector<T>
+template <typename T> struct MemoryTagOf { static constexpr MemoryTag value = MemoryTag::OTHER; };
+template <> struct MemoryTagOf<Enclosure> { static constexpr MemoryTag value = MemoryTag::ENCLOSURES; };
+
+// Шаблон CowVector - вектор с копированием при записи.
+// Копия вектора разделяет с оригиналом и список элементов, и сами элементы:
+// список копируется при первом изменении состава, элемент - при первой записи в него.
+// Чтение через const-доступ (as_const) никогда ничего не копирует.
+template <typename T>
+class CowVector {
+public:
+    // Итератор с доступом на запись (элемент отделяется при разыменовании)
+    class iterator {
+    public:
+        using iterator_category = random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        iterator(CowVector* _owner, size_t _index) : owner(_owner), index(_index) {}
+
+        T& operator*() const { return (*owner)[index]; }
+        T* operator->() const { return &(*owner)[index]; }
+        T& operator[](ptrdiff_t offset) const { return (*owner)[index + offset]; }
+        iterator& operator++() { index++; return *this; }
+        iterator& operator--() { index--; return *this; }
+        iterator& operator+=(ptrdiff_t offset) { index += offset; return *this; }
+        iterator& operator-=(ptrdiff_t offset) { index -= offset; return *this; }
+        iterator operator+(ptrdiff_t offset) const { return iterator(owner, index + offset); }
+        iterator operator-(ptrdiff_t offset) const { return iterator(owner, index - offset); }
+        ptrdiff_t operator-(const iterator& other) const { return (ptrdiff_t)index - (ptrdiff_t)other.index; }
+        bool operator==(const iterator& other) const { return index == other.index; }
+        bool operator!=(const iterator& other) const { return index != other.index; }
+        bool operator<(const iterator& other) const { return index < other.index; }
+
+    private:
+        friend class CowVector;
+        CowVector* owner; // Вектор, по которому идет обход
+        size_t index;     // Текущая позиция
+    };
+
+    // Итератор только для чтения
+    class const_iterator {
+    public:
+        using iterator_category = random_access_iterator_tag;
+        using value_type = T;
+        using difference_type = ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        const_iterator(const CowVector* _owner, size_t _index) : owner(_owner), index(_index) {}
+
+        const T& operator*() const { return (*owner)[index]; }
+        const T* operator->() const { return &(*owner)[index]; }
+        const_iterator& operator++() { index++; return *this; }
+        const_iterator operator+(ptrdiff_t offset) const { return const_iterator(owner, index + offset); }
+        ptrdiff_t operator-(const const_iterator& other) const { return (ptrdiff_t)index - (ptrdiff_t)other.index; }
+        bool operator==(const const_iterator& other) const { return index == other.index; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+
+    private:
+        const CowVector* owner; // Вектор, по которому идет обход
+        size_t index;           // Текущая позиция
+    };
+
+    CowVector() : items(allocate_shared<List>(TrackingAllocator<List, tag>())) {}
+
+    size_t size() const { return items->size(); }
+    bool empty() const { return items->empty(); }
+
+    const T& operator[](size_t index) const { return *(*items)[index]; }
+    T& operator[](size_t index) { return mutableAt(index); }
+    const T& front() const { return (*this)[0]; }
+    const T& back() const { return (*this)[size() - 1]; }
+    T& back() { return mutableAt(size() - 1); }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, size()); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    void push_back(const T& value) {
+        detachList();
+        items->push_back(allocate_shared<T>(TrackingAllocator<T, tag>(), value));
+    }
+
+    template <typename... Args>
+    void emplace_back(Args&&... args) {
+        detachList();
+        items->push_back(allocate_shared<T>(TrackingAllocator<T, tag>(), forward<Args>(args)...));
+    }
+
+    iterator erase(iterator position) {
+        detachList();
+        items->erase(items->begin() + position.index);
+        return position;
+    }
+
+    void clear() {
+        detachList();
+        items->clear();
+    }
+
+    void reserve(size_t count) {
+        detachList();
+        items->reserve(count);
+    }
+
+    // Разделяет ли элемент память с другой копией вектора
+    bool isShared(size_t index) const {
+        return items.use_count() > 1 || (*items)[index].use_count() > 1;
+    }
+
+private:
+    static constexpr MemoryTag tag = MemoryTagOf<T>::value; // Подсистема для учета памяти
+    using List = TrackedVector<shared_ptr<T>, tag>;
+
+    shared_ptr<List> items; // Общий список указателей на элементы
+
+    // Отделение списка элементов от других копий
+    void detachList() {
+        if (items.use_count() > 1) {
+            items = allocate_shared<List>(TrackingAllocator<List, tag>(), *items);
+        }
+    }
+
+    // Доступ на запись: элемент копируется, если его еще разделяют другие копии
+    T& mutableAt(size_t index) {
+        detachList();
+        shared_ptr<T>& item = (*items)[index];
+        if (item.use_count() > 1) {
+            item = allocate_shared<T>(TrackingAllocator<T, tag>(), *item);
+        }
+        return *item;
+    }
+};
+
+// Структура NameHandle - компактный дескриптор имени в общем пуле имен.
+// 0 - пустое имя; старший бит - сгенерированное имя "основа номер", которое
+// кодируется прямо в дескрипторе (основа в битах 10-30, номер в битах 0-9);
+// иначе - номер строки в пуле, начиная с 1.
+struct NameHandle {
+    uint32_t value = 0; // Закодированное имя
+
+    bool empty() const {
+        return value == 0;
+    }
+
+    bool isGenerated() const {
+        return (value & 0x80000000u) != 0;
+    }
+
+    bool operator==(NameHandle other) const {
+        return value == other.value;
+    }
+
+    bool operator!=(NameHandle other) const {
+        return value != other.value;
+    }
+
+    // Сгенерированное имя: основа word из таблицы пула и номер 0-999 (без обращения к пулу)
+    static NameHandle generated(int word, int number) {
+        NameHandle handle;
+        handle.value = 0x80000000u | ((uint32_t)word << 10) | (uint32_t)number;
+        return handle;
+    }
+
+    // Имя из текста (строка добавляется в общий пул, если ее там еще нет)
+    static NameHandle of(const wstring& text);
+
+    // Текст имени
+    wstring str() const;
+};
+
+// Класс NamePool - общий пул имен в UTF-8.
+// Каждая строка хранится один раз в блоках памяти, которые никогда не перемещаются,
+// сущности держат только 4-байтовый NameHandle. Пул общий для всех зоопарков мира,
+// поэтому добавление и чтение защищены мьютексом (сгенерированные имена его не трогают).
+class NamePool {
+public:
+    // Общий пул программы
+    static NamePool& shared() {
+        static NamePool pool;
+        return pool;
+    }
+
+    // Добавление строки в пул (повторная строка возвращает прежний дескриптор)
+    NameHandle intern(const wstring& text) {
+        NameHandle handle;
+        if (text.empty()) return handle;
+
+        string utf8 = toUtf8(text);
+        lock_guard<mutex> lock(guard);
+        auto found = lookup.find(utf8);
+        if (found != lookup.end()) {
+            handle.value = found->second;
+            return handle;
         }
+
+        string_view stored = store(utf8);
+        entries.push_back(stored);
+        handle.value = (uint32_t)entries.size();
+        lookup.emplace(stored, handle.value);
+        return handle;
     }
 
-    // Оператор для размножения животных
-    Animal operator+(Animal& other) {
-        // Проверка совместимости животных для размножения
-        if (this->gender == other.gender) {
-            throw runtime_error("Должен быть разный гендр");
+    // Текст имени по дескриптору
+    wstring text(NameHandle handle) const {
+        if (handle.empty()) return wstring();
+        if (handle.isGenerated()) {
+            uint32_t word = (handle.value >> 10) & 0x1FFFFFu;
+            wstring result = word < GENERATED_NAME_WORDS ? generatedWords[word] : L"?";
+            return result.append(L" ").append(to_wstring(handle.value & 0x3FFu));
         }
-        if (this->age <= 5 || other.age <= 5) {
-            throw runtime_error("Слишком молодые (должно быть возрасть больше 5 дн)");
+
+        lock_guard<mutex> lock(guard);
+        string_view stored = entries[handle.value - 1];
+        return fromUtf8(stored.data(), stored.size());
+    }
+
+    // Количество строк в пуле
+    size_t size() const {
+        lock_guard<mutex> lock(guard);
+        return entries.size();
+    }
+
+    // Память, занятая блоками пула (в байтах)
+    size_t bytes() const {
+        lock_guard<mutex> lock(guard);
+        size_t total = 0;
+        for (const auto& block : blocks) {
+            total += block.size;
         }
+        return total;
+    }
+
+    // Основы сгенерированных имен животных (по 5 на каждый общий тип, в порядке магазина)
+    static constexpr const wchar_t* generatedWords[GENERATED_NAME_WORDS] = {
+        L"Рыжик", L"Полосатик", L"Пятнышко", L"Грива", L"Коготь",
+        L"Бобик", L"Шарик", L"Рекс", L"Лорд", L"Тузик",
+        L"Крыло", L"Клюв", L"Перо", L"Коготок", L"Пташка",
+        L"Шип", L"Чешуя", L"Змей", L"Клык", L"Хвост",
+        L"Волна", L"Плавник", L"Пузырь", L"Ракушка", L"Жемчуг"
+    };
+
+    // Преобразование в UTF-8 (wchar_t - UTF-16 в Windows и UTF-32 в Linux)
+    static string toUtf8(const wstring& text) {
+        string result;
+        result.reserve(text.size() * 2);
+        for (size_t i = 0; i < text.size(); i++) {
+            uint32_t code = (uint32_t)text[i];
+            if (code >= 0xD800 && code < 0xDC00 && i + 1 < text.size()) {
+                code = 0x10000 + ((code - 0xD800) << 10) + ((uint32_t)text[++i] - 0xDC00);
+            }
+            if (code < 0x80) {
+                result += (char)code;
+            }
+            else if (code < 0x800) {
+                result += (char)(0xC0 | (code >> 6));
+                result += (char)(0x80 | (code & 0x3F));
+            }
+            else if (code < 0x10000) {
+                result += (char)(0xE0 | (code >> 12));
+                result += (char)(0x80 | ((code >> 6) & 0x3F));
+                result += (char)(0x80 | (code & 0x3F));
+            }
+            else {
+                result += (char)(0xF0 | (code >> 18));
+                result += (char)(0x80 | ((code >> 12) & 0x3F));
+                result += (char)(0x80 | ((code >> 6) & 0x3F));
+                result += (char)(0x80 | (code & 0x3F));
+            }
+        }
+        return result;
+    }
+
+    // Преобразование из UTF-8
+    static wstring fromUtf8(const char* data, size_t length) {
+        wstring result;
+        result.reserve(length);
+        for (size_t i = 0; i < length;) {
+            unsigned char lead = (unsigned char)data[i];
+            int extra = lead >= 0xF0 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC0 ? 1 : 0;
+            uint32_t code = extra == 0 ? lead : lead & (0x3F >> extra);
+            for (int k = 1; k <= extra && i + k < length; k++) {
+                code = (code << 6) | ((unsigned char)data[i + k] & 0x3F);
+            }
+            i += extra + 1;
+            if (code >= 0x10000 && sizeof(wchar_t) == 2) {
+                code -= 0x10000;
+                result += (wchar_t)(0xD800 + (code >> 10));
+                result += (wchar_t)(0xDC00 + (code & 0x3FF));
+            }
+            else {
+                result += (wchar_t)code;
+            }
+        }
+        return result;
+    }
+
+private:
+    // Блок памяти пула
+    struct Block {
+        unique_ptr<char[]> data; // Байты строк
+        size_t size = 0;         // Размер блока
+        size_t used = 0;         // Занято байт
+    };
+
+    TrackedVector<Block, MemoryTag::NAMES> blocks;       // Блоки памяти (строки в них не перемещаются)
+    TrackedVector<string_view, MemoryTag::NAMES> entries; // Строки по номеру дескриптора
+    unordered_map<string_view, uint32_t, hash<string_view>, equal_to<string_view>,
+        TrackingAllocator<pair<const string_view, uint32_t>, MemoryTag::NAMES>> lookup; // Поиск дескриптора по строке
+    mutable mutex guard;                                  // Защита при работе нескольких потоков
+
+    // Копирование строки в блок (длинная строка получает собственный блок)
+    string_view store(const string& utf8) {
+        if (blocks.empty() || blocks.back().size - blocks.back().used < utf8.size()) {
+            Block block;
+            block.size = max((size_t)NAME_ARENA_BLOCK_SIZE, utf8.size());
+            block.data.reset(new char[block.size]);
+            MemoryTracker::allocated(MemoryTag::NAMES, block.size); // Блоки пула не освобождаются
+            blocks.push_back(move(block));
+        }
+        Block& block = blocks.back();
+        char* target = block.data.get() + block.used;
+        copy(utf8.begin(), utf8.end(), target);
+        block.used += utf8.size();
+        return string_view(target, utf8.size());
+    }
+};
+
+NameHandle NameHandle::of(const wstring& text) {
+    return NamePool::shared().intern(text);
+}
+
+wstring NameHandle::str() const {
+    return NamePool::shared().text(*this);
+}
+
+// Вывод имени в поток
+wostream& operator<<(wostream& out, NameHandle name) {
+    return out << name.str();
+}
+
+// Структура AnimalVitals - горячие данные животного, которые читаются каждый день
+// (упакованы в 16 байт; все битовые поля 32-битные, чтобы MSVC и GCC раскладывали их одинаково)
+// В вольере эти записи лежат отдельным непрерывным столбцом (см. AnimalTable).
+struct AnimalVitals {
+    int id = 0;                 // Уникальный идентификатор
+    int price = 0;              // Цена животного
+    unsigned age : 16;          // Возраст в днях
+    unsigned weight : 16;       // Вес в кг
+    int happiness : 8;          // Уровень счастья (0-100)
+    AnimalState state : 2;      // Состояние здоровья (больное животное - SICK)
+    Diet diet : 1;              // Тип питания (хищник/травоядное)
+    Climate climate : 2;        // Предпочитаемый климат
+    unsigned isPredator : 1;    // Является ли хищником
+    unsigned isHungry : 1;      // Голоден ли
+    unsigned isUnhappy : 1;     // Несчастлив ли
+    unsigned bornInZoo : 1;     // Родилось ли в зоопарке
+    unsigned female : 1;        // Пол: 1 - самка, 0 - самец
+    unsigned species : 5;       // Номер вида в таблице видов (0 - вид не задан)
+
+    AnimalVitals() : age(0), weight(0), happiness(50), state(AnimalState::HEALTHY), diet(Diet::HERBIVORES),
+        climate(Climate::CONTINENT), isPredator(0), isHungry(0), isUnhappy(0), bornInZoo(0), female(0), species(0) {
+    }
+
+    // Пол ('M' или 'F')
+    wchar_t gender() const {
+        return female ? 'F' : 'M';
+    }
+};
+
+// Структура AnimalRecord - холодные данные животного: нужны при выводе, размножении,
+// заражении и глубокой старости, но не при ежедневных проходах по вольерам
+struct AnimalRecord {
+    Genome genome;      // Гены веса, долголетия, устойчивости и плодовитости
+    NameHandle name;    // Имя животного (в общем пуле имен)
+    int parent1Id = 0;  // ID первого родителя (0 - неизвестен)
+    int parent2Id = 0;  // ID второго родителя (0 - неизвестен)
+};
+
+static_assert(sizeof(AnimalVitals) == 16, "Горячие данные животного должны занимать 16 байт");
+static_assert(SPECIES_COUNT < 32, "Номер вида должен помещаться в 5 бит");
+static_assert(sizeof(AnimalVitals) + sizeof(AnimalRecord) <= 40, "Животное в вольере должно занимать не больше 40 байт");
+
+// Класс Animal - представляет животное в зоопарке (полная запись: горячие и холодные данные).
+// Вид хранится номером в таблице видов, названия типа и вида берутся из нее.
+class Animal : public AnimalVitals, public AnimalRecord {
+public:
+    // Конструктор с параметрами
+    Animal(NameHandle _name, int _age, int _weight, int _price, Diet _diet, Climate _climate, AnimalState _state, int _id) {
+        name = _name;
+        id = _id;
+        price = _price;
+        age = _age;
+        weight = _weight;
+        diet = _diet;
+        climate = _climate;
+        state = _state;
+    }
+
+    // Конструктор по умолчанию
+    Animal() {}
+
+    // Сборка полной записи из столбцов вольера
+    Animal(const AnimalVitals& vitals, const AnimalRecord& record) : AnimalVitals(vitals), AnimalRecord(record) {}
+
+    // Общий тип (кошачьи, псовые и т.д.)
+    const wstring& type() const {
+        return speciesType(species);
+    }
+
+    // Конкретный вид (лев, тигр и т.д.)
+    const wstring& specificType() const {
+        return speciesName(species);
+    }
+
+    // Метод проверки пары для размножения (без исключений)
+    static BreedingError checkBreeding(const Animal& first, const Animal& second) {
+        if (first.female == second.female) return BreedingError::SAME_GENDER;
+        if (first.age <= BREEDING_AGE || second.age <= BREEDING_AGE) return BreedingError::TOO_YOUNG;
+        return BreedingError::NONE;
+    }
+
+    // Метод заполнения потомка на месте по данным родителей (пара должна быть проверена)
+    void initOffspring(const Animal& first, const Animal& second, GameRandom& random) {
+        static const wchar_t* const prefixes[] = { L"Малыш", L"Кроха", L"Детка", L"Малышка", L"Крошка" };
+
+        species = first.species;
+        age = 0;
+        genome = Genome::cross(first.genome, second.genome, random);
+        // Детеныш весит в среднем четверть суммы родителей; ген веса дает от 0.5 до 1.5 этой доли
+        weight = (first.weight + second.weight) * (Genome::GENE_BITS / 2 + genome.trait(Genome::WEIGHT)) / (4 * Genome::GENE_BITS);
+        diet = first.diet;
+        climate = first.climate;
+        state = AnimalState::HEALTHY;
+        isPredator = first.isPredator;
+        happiness = 100;
+        female = random.range(2) != 0;
 
-        // Создание потомка
-        Animal offspring;
-        offspring.type = this->type;
-        offspring.specificType = this->specificType;
-        offspring.age = 0;
-        offspring.weight = (this->weight + other.weight) / 4;
-        offspring.climate = this->climate;
-        offspring.isPredator = this->isPredator;
-        offspring.happiness = 100;
-        offspring.gender = (rand() % 2 == 0) ? 'M' : 'F';
-        
         // Сохранение информации о родителях
-        offspring.parent1 = new Animal(*this);
-        offspring.parent2 = new Animal(other);
-        offspring.bornInZoo = true;
+        parent1Id = first.id;
+        parent2Id = second.id;
+        bornInZoo = true;
+
+        // Имя собирается в одном буфере и добавляется в общий пул
+        const wchar_t* prefix = prefixes[random.range(5)];
+        wstring firstName = first.name.str();
+        wstring secondName = second.name.str();
+        wstring fullName;
+        fullName.reserve(wcslen(prefix) + firstName.size() + secondName.size() + 4);
+        fullName.append(prefix).append(L" ").append(firstName).append(L" и ").append(secondName);
+        name = NameHandle::of(fullName);
+    }
+
+    // Имя для вывода
+    wstring displayName() const {
+        return name.str();
+    }
+
+    // Самый ранний возраст старости (при нулевом гене долголетия)
+    static const int EARLIEST_OLD_AGE = OLD_AGE_THRESHOLD - Genome::GENE_BITS / 2 * LIFESPAN_GENE_DAYS;
+
+    // Возраст, после которого животное с геномом genome может умереть от старости
+    static int oldAgeOf(Genome genome) {
+        return OLD_AGE_THRESHOLD + (genome.trait(Genome::LIFESPAN) - Genome::GENE_BITS / 2) * LIFESPAN_GENE_DAYS;
+    }
+
+    // Шанс умереть от старости за день в процентах (одинаков для отдельных животных и стад)
+    static int oldAgeDeathChance(int age, Genome genome) {
+        int oldAge = oldAgeOf(genome);
+        return age > oldAge ? min(99, (age - oldAge) / 10) : 0;
+    }
+
+    // Шанс зачатия пары в процентах (по средней плодовитости родителей)
+    static int conceptionChance(const Animal& first, const Animal& second) {
+        int fertility = (first.genome.trait(Genome::FERTILITY) + second.genome.trait(Genome::FERTILITY)) / 2;
+        return min(100, FERTILITY_BASE_CHANCE + fertility * FERTILITY_GENE_PERCENT);
+    }
+};
+
+// Класс AnimalTable - животные вольера в двух непрерывных столбцах: горячие данные
+// (AnimalVitals по 16 байт, их читают ежедневные проходы) и холодные (AnimalRecord).
+// Столбцы общие у копий вольера и копируются целиком при первой записи в них.
+// Чтение через [] и обход собирают полную запись Animal по значению; запись идет
+// через vitals() и record(), поэтому ссылки на животных после изменения не хранятся.
+class AnimalTable {
+public:
+    using Vitals = TrackedVector<AnimalVitals, MemoryTag::ANIMALS>;
+    using Records = TrackedVector<AnimalRecord, MemoryTag::ANIMALS>;
+
+    // Итератор только для чтения (выдает полную запись животного)
+    class const_iterator {
+    public:
+        const_iterator(const AnimalTable* _owner, size_t _index) : owner(_owner), index(_index) {}
+
+        const Animal operator*() const { return (*owner)[index]; }
+        const_iterator& operator++() { index++; return *this; }
+        bool operator!=(const const_iterator& other) const { return index != other.index; }
+
+    private:
+        const AnimalTable* owner; // Таблица, по которой идет обход
+        size_t index;             // Текущая позиция
+    };
+
+    AnimalTable() : hot(allocate_shared<Vitals>(TrackingAllocator<Vitals, MemoryTag::ANIMALS>())),
+        cold(allocate_shared<Records>(TrackingAllocator<Records, MemoryTag::ANIMALS>())) {
+    }
+
+    size_t size() const { return hot->size(); }
+    bool empty() const { return hot->empty(); }
+
+    // Полная запись животного (const, чтобы присваивание полю копии не компилировалось)
+    const Animal operator[](size_t index) const { return Animal((*hot)[index], (*cold)[index]); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    // Горячие данные животного
+    const AnimalVitals& vitals(size_t index) const { return (*hot)[index]; }
+    AnimalVitals& vitals(size_t index) { return allVitals()[index]; }
+
+    // Холодные данные животного
+    const AnimalRecord& record(size_t index) const { return (*cold)[index]; }
+    AnimalRecord& record(size_t index) {
+        detach(cold);
+        return (*cold)[index];
+    }
+
+    // Столбец горячих данных целиком (для ежедневных проходов)
+    const Vitals& allVitals() const { return *hot; }
+    Vitals& allVitals() {
+        detach(hot);
+        return *hot;
+    }
+
+    void push_back(const Animal& animal) {
+        allVitals().push_back(animal);
+        detach(cold);
+        cold->push_back(animal);
+    }
+
+    void erase(size_t index) {
+        allVitals().erase(hot->begin() + index);
+        detach(cold);
+        cold->erase(cold->begin() + index);
+    }
 
-        // Генерация имени для потомка
-        wstring names[] = { L"Малыш", L"Кроха", L"Детка", L"Малышка", L"Крошка" };
-        offspring.wname = names[rand() % 5] + L" " + this->wname + L" и " + other.wname;
+private:
+    shared_ptr<Vitals> hot;   // Горячие данные по порядку животных
+    shared_ptr<Records> cold; // Холодные данные в том же порядке
 
-        return offspring;
+    // Отделение столбца от других копий вольера
+    template <typename Column>
+    static void detach(shared_ptr<Column>& column) {
+        if (column.use_count() > 1) {
+            column = allocate_shared<Column>(TrackingAllocator<Column, MemoryTag::ANIMALS>(), *column);
+        }
     }
+};
+
+// Структура EnclosureLevel - параметры вольера на одном уровне улучшения
+struct EnclosureLevel {
+    int capacity = 0;    // Вместимость
+    int dailyCost = 0;   // Ежедневные расходы
+    int upgradeCost = 0; // Стоимость улучшения до следующего уровня (0 - уровень максимальный)
+    int salePrice = 0;   // Цена продажи вольера
+};
 
-    // Деструктор - освобождает память от родителей, если животное родилось в зоопарке
-    ~Animal() {
-        if (bornInZoo) {
-            delete parent1;
-            delete parent2;
+// Шаблон EnclosureEconomics - экономика вольера одного вида.
+// Таблица уровней строится на этапе компиляции из параметров вида,
+// и все расчеты стоимости берут значения только из нее.
+template <EnclosureKind Kind>
+struct EnclosureEconomics {
+    static constexpr bool breeding = Kind == EnclosureKind::BREEDING;
+    static constexpr int buildCost = breeding ? BREEDING_ENCLOSURE_COST : BASE_ENCLOSURE_COST;
+    static constexpr int baseCapacity = breeding ? 3 : 2;
+    static constexpr int capacityStep = breeding ? 3 : 2;
+    static constexpr int baseDailyCost = breeding ? 80 : 50;
+    static constexpr int dailyCostStep = 20;
+    static constexpr int upgradeCostStep = 200;
+    static constexpr int baseSalePrice = breeding ? 500 : 300;
+    static constexpr int salePriceStep = 100;
+
+    // Построение таблицы (номер элемента - уровень, элемент 0 не используется)
+    static constexpr array<EnclosureLevel, MAX_ENCLOSURE_LEVEL + 1> makeLevels() {
+        array<EnclosureLevel, MAX_ENCLOSURE_LEVEL + 1> table{};
+        for (int level = 1; level <= MAX_ENCLOSURE_LEVEL; level++) {
+            table[level].capacity = baseCapacity + (level - 1) * capacityStep;
+            table[level].dailyCost = baseDailyCost + (level - 1) * dailyCostStep;
+            table[level].upgradeCost = level < MAX_ENCLOSURE_LEVEL ? upgradeCostStep * level : 0;
+            table[level].salePrice = baseSalePrice + (level - 1) * salePriceStep;
         }
+        return table;
+    }
+
+    static constexpr array<EnclosureLevel, MAX_ENCLOSURE_LEVEL + 1> levels = makeLevels();
+};
+
+static_assert(EnclosureEconomics<EnclosureKind::REGULAR>::levels[1].capacity == 2, "Обычный вольер начинается с 2 мест");
+static_assert(EnclosureEconomics<EnclosureKind::BREEDING>::levels[MAX_ENCLOSURE_LEVEL].upgradeCost == 0, "Последний уровень не улучшается");
+
+// Функция получения параметров вольера вида kind на уровне level
+inline const EnclosureLevel& enclosureLevel(EnclosureKind kind, int level) {
+    level = max(1, min(MAX_ENCLOSURE_LEVEL, level));
+    return kind == EnclosureKind::BREEDING ? EnclosureEconomics<EnclosureKind::BREEDING>::levels[level]
+        : EnclosureEconomics<EnclosureKind::REGULAR>::levels[level];
+}
+
+// Функция получения стоимости строительства вольера вида kind
+constexpr int enclosureBuildCost(EnclosureKind kind) {
+    return kind == EnclosureKind::BREEDING ? EnclosureEconomics<EnclosureKind::BREEDING>::buildCost
+        : EnclosureEconomics<EnclosureKind::REGULAR>::buildCost;
+}
+
+// Структура Cohort - стадо одинаковых животных одного вида, пола и возрастной группы.
+// Хранятся только общие признаки и число здоровых и больных, поэтому день стада
+// обсчитывается за O(1) при любой численности. Отдельное животное выделяется из стада,
+// только когда игрок осматривает, переименовывает или размножает его.
+struct Cohort {
+    Animal prototype;  // Общие признаки (вид, пол, питание, климат, вес, цена, гены); возраст - возраст стада
+    int healthy = 0;   // Здоровых животных
+    int sick = 0;      // Больных животных
+
+    // Живых животных в стаде
+    int living() const {
+        return healthy + sick;
+    }
+
+    // Может ли животное войти в это стадо
+    bool accepts(const Animal& animal) const {
+        return prototype.species == animal.species && prototype.female == animal.female &&
+            prototype.climate == animal.climate && prototype.age / COHORT_AGE_BUCKET == animal.age / COHORT_AGE_BUCKET;
     }
 };
 
@@ -141,18 +965,23 @@ public:
     // Основные атрибуты вольера (вариант 1)
     int capacity = 0;           // Вместимость вольера
     Climate climate;            // Климат вольера
-    vector<Animal> animals;     // Животные в вольере
+    AnimalTable animals;        // Животные в вольере (столбцы общие с копиями до первого изменения)
+    TrackedVector<Cohort, MemoryTag::ANIMALS> cohorts; // Стада (животные без отдельных записей)
     int dirty = 0;              // Уровень загрязнения
+    int eaters[2] = { 0, 0 };   // Живые животные по типу питания (для расчета кормления)
+    int happinessSum = 0;       // Суммарное счастье живых животных (для расчета выручки)
+    bool mayBeHungry[2] = { false, false }; // Могут ли быть голодные животные этого типа питания (сбрасывается после полного кормления)
 
     // Дополнительные атрибуты (вариант 2)
-    string name;                // Название вольера
+    NameHandle name;            // Название вольера (в общем пуле имен)
     wstring animalType;         // Тип животных
     wstring specificAnimalType; // Конкретный вид животных
-    int dailyCost = 50;         // Ежедневные расходы
+    int dailyCost = EnclosureEconomics<EnclosureKind::REGULAR>::levels[1].dailyCost; // Ежедневные расходы (по таблице уровней)
     bool isPredatorEnclosure = false; // Для хищников ли
     bool isBreedingEnclosure = false; // Для размножения ли
     int upgradeLevel = 1;       // Уровень улучшения
     bool isDirty = false;       // Грязный ли
+    int id = 0;                 // Уникальный идентификатор (для планировщика событий)
 
     // Конструктор с параметрами
     Enclosure(int _capacity, Climate _climate) :
@@ -161,21 +990,72 @@ public:
     }
 
     // Конструктор по умолчанию
-    Enclosure() : capacity(0), dirty(0), dailyCost(50),
+    Enclosure() : capacity(0), dirty(0),
         isPredatorEnclosure(false), isBreedingEnclosure(false),
         upgradeLevel(1), isDirty(false) {
     }
 
+    // Метод создания нового вольера вида kind (параметры берутся из таблицы уровней)
+    static Enclosure make(EnclosureKind kind, Climate climate) {
+        const EnclosureLevel& level = enclosureLevel(kind, 1);
+        Enclosure enclosure(level.capacity, climate);
+        enclosure.dailyCost = level.dailyCost;
+        enclosure.isBreedingEnclosure = kind == EnclosureKind::BREEDING;
+        return enclosure;
+    }
+
+    // Вид вольера
+    EnclosureKind kind() const {
+        return isBreedingEnclosure ? EnclosureKind::BREEDING : EnclosureKind::REGULAR;
+    }
+
+    // Параметры текущего уровня вольера
+    const EnclosureLevel& economics() const {
+        return enclosureLevel(kind(), upgradeLevel);
+    }
+
+    // Животных в стадах
+    int herdSize() const {
+        int total = 0;
+        for (const Cohort& cohort : cohorts) total += cohort.living();
+        return total;
+    }
+
+    // Больных животных в стадах
+    int herdSick() const {
+        int total = 0;
+        for (const Cohort& cohort : cohorts) total += cohort.sick;
+        return total;
+    }
+
+    // Занятые места: отдельные животные и стада
+    int occupancy() const {
+        return (int)animals.size() + herdSize();
+    }
+
+    // Живые животные (отдельные и в стадах)
+    int living() const {
+        return eaters[0] + eaters[1];
+    }
+
+    // Метод учета count живых животных, похожих на animal, в счетчиках вольера
+    // (count < 0 - животные умерли или покинули вольер)
+    void countLiving(const AnimalVitals& animal, int count) {
+        eaters[(int)animal.diet] += count;
+        happinessSum += animal.happiness * count;
+    }
+
     // Метод добавления животного в вольер
     bool addAnimal(const Animal& animal) {
         // Проверка на переполнение вольера
-        if (animals.size() >= capacity) return false;
+        if (occupancy() >= capacity) return false;
         // Проверка совместимости по типу питания
-        if (!animals.empty() && animal.diet != animals[0].diet) return false;
+        if (!animals.empty() && animal.diet != as_const(animals).vitals(0).diet) return false;
         // Проверка совместимости по климату
         if (animal.climate != climate) return false;
         
         animals.push_back(animal);
+        if (animal.state != AnimalState::DEAD) countLiving(animal, 1);
         return true;
     }
 
@@ -183,67 +1063,145 @@ public:
     void sellAnimal(int id) {
         for (size_t i = 0; i < animals.size(); i++) {
             if (animals[i].id == id) {
-                animals.erase(animals.begin() + i);
+                if (animals[i].state != AnimalState::DEAD) countLiving(animals.vitals(i), -1);
+                animals.erase(i);
                 break;
             }
         }
     }
 
+    // Метод поиска животного по ID, возвращает номер в вольере или -1
+    int findAnimal(int id) const {
+        for (size_t i = 0; i < animals.size(); i++) {
+            if (animals.vitals(i).id == id) return (int)i;
+        }
+        return -1;
+    }
+
     // Проверка, нужна ли уборка вольера
     bool needsCleaning() {
-        return dirty > 5;
+        return dirty > DIRT_CLEANING_THRESHOLD;
+    }
+
+    // Через сколько дней вольеру понадобится уборка
+    int daysUntilCleaning() const {
+        if (dirty > DIRT_CLEANING_THRESHOLD) return 0;
+        return (DIRT_CLEANING_THRESHOLD - dirty) / DIRT_PER_DAY + 1;
     }
 
-    // Метод уборки вольера
-    void clean() {
-        dirty = 0;
-        isDirty = false;
+    // Метод уборки вольера (efficiency - доля убранной грязи в процентах)
+    void clean(int efficiency = 100) {
+        dirty = dirty * (100 - min(100, efficiency)) / 100;
+        isDirty = needsCleaning();
     }
 
     // Метод обновления состояния вольера
-    void update() {
+    // (ID заболевших животных добавляются в infected, если он передан)
+    void update(vector<int>* infected = nullptr) {
         // Увеличение уровня загрязнения
-        dirty += 2;
+        dirty += DIRT_PER_DAY;
 
         // Подсчет животных и больных животных
         int totalAnimal = 0;
         int totalSickAnimal = 0;
-        for (auto& animal : animals) {
+        for (const AnimalVitals& animal : as_const(animals).allVitals()) {
             totalAnimal += (animal.state != AnimalState::DEAD) ? 1 : 0;
             totalSickAnimal += (animal.state == AnimalState::SICK) ? 1 : 0;
         }
 
-        // Распространение болезни, если есть больные животные
-        if (totalSickAnimal) {
+        // Распространение болезни, если есть больные животные (в том числе в стадах): заражаются
+        // наименее устойчивые здоровые животные (на запись берутся только заболевающие)
+        if (totalSickAnimal || herdSick()) {
             for (int i = 0; i < 2; i++) {
-                for (auto& animal : animals) {
-                    if (animal.state == AnimalState::HEALTHY) {
-                        animal.state = AnimalState::SICK;
-                        break;
+                int weakest = -1;
+                int weakestResistance = IMMUNE_RESISTANCE;
+                for (size_t j = 0; j < animals.size(); j++) {
+                    if (as_const(animals).vitals(j).state != AnimalState::HEALTHY) continue;
+                    int resistance = as_const(animals).record(j).genome.trait(Genome::RESISTANCE);
+                    if (resistance < weakestResistance) {
+                        weakest = (int)j;
+                        weakestResistance = resistance;
                     }
                 }
+                if (weakest < 0) break;
+                AnimalVitals& patient = animals.vitals(weakest);
+                patient.state = AnimalState::SICK;
+                if (infected != nullptr) infected->push_back(patient.id);
             }
         }
     }
 };
 
+// Структура StateDigest - инкрементальный хэш состояния зоопарка.
+// Каждое животное и вольер дают свой 64-битный вклад, вклады объединяются через XOR,
+// поэтому при изменении объекта пересчитывается только его вклад: value ^= было ^ стало.
+// Имена в хэш не входят: дескрипторы интернированных имен зависят от порядка потоков.
+struct StateDigest {
+    uint64_t value = 0; // XOR вкладов всех животных и вольеров
+
+    // Добавление или удаление вклада (для XOR это одна операция)
+    void toggle(uint64_t part) {
+        value ^= part;
+    }
+
+    // Замена вклада изменившегося объекта
+    void replace(uint64_t before, uint64_t after) {
+        value ^= before ^ after;
+    }
+
+    // Перемешивание битов (финализатор splitmix64)
+    static uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // Добавление значения к последовательному хэшу
+    static uint64_t combine(uint64_t hash, uint64_t value) {
+        return mix(hash ^ mix(value));
+    }
+
+    // Вклад животного в вольере enclosureId
+    static uint64_t animal(int enclosureId, const AnimalVitals& animal) {
+        uint64_t hash = combine((uint32_t)enclosureId, (uint32_t)animal.id);
+        hash = combine(hash, ((uint64_t)(uint32_t)animal.price << 32) | (animal.age << 16) | animal.weight);
+        uint32_t flags = (uint32_t)(animal.happiness & 0xFF) | ((uint32_t)animal.state << 8) |
+            ((uint32_t)animal.diet << 10) | ((uint32_t)animal.climate << 11) | (animal.isPredator << 13) |
+            (animal.isHungry << 14) | (animal.isUnhappy << 15) | (animal.bornInZoo << 16) | (animal.female << 17) |
+            (animal.species << 18);
+        return combine(hash, flags);
+    }
+
+    // Вклад вольера вместе со стадами (отдельные животные дают собственные вклады)
+    static uint64_t enclosure(const Enclosure& enclosure) {
+        uint64_t hash = combine(0x454E43ull, (uint32_t)enclosure.id);
+        for (const Cohort& cohort : enclosure.cohorts) {
+            hash = combine(hash, animal(enclosure.id, cohort.prototype));
+            hash = combine(hash, ((uint64_t)(uint32_t)cohort.healthy << 32) | (uint32_t)cohort.sick);
+        }
+        hash = combine(hash, ((uint64_t)(uint32_t)enclosure.capacity << 32) | (uint32_t)enclosure.dirty);
+        return combine(hash, ((uint32_t)enclosure.upgradeLevel << 8) | ((uint32_t)enclosure.climate << 1) |
+            (enclosure.isBreedingEnclosure ? 1u : 0u));
+    }
+};
+
 // Класс Employee - представляет сотрудника зоопарка
 class Employee {
 public:
     // Основные атрибуты (вариант 1)
-    string name;        // Имя сотрудника
+    NameHandle name;    // Имя сотрудника (в общем пуле имен)
     int price = 0;      // Зарплата
     WorkerRole role;    // Должность
     bool tired = false; // Устал ли
 
     // Дополнительные атрибуты (вариант 2)
-    wstring wname;      // Имя (unicode)
     wstring position;   // Должность
     int salary = 0;     // Зарплата
     int efficiency = 0; // Эффективность
 
     // Конструктор с параметрами
-    Employee(string _name, int _price, WorkerRole _role) :
+    Employee(NameHandle _name, int _price, WorkerRole _role) :
         name(_name), price(_price), role(_role), tired(false) {
     }
 
@@ -256,244 +1214,2456 @@ public:
     }
 };
 
-// Класс Zoo - основной класс, представляющий зоопарк
-class Zoo {
+// Структура FoodLot - партия еды с ограниченным сроком годности
+struct FoodLot {
+    int amount = 0;    // Количество еды
+    int expiryDay = 0; // День, в который партия испортится
+};
+
+// Класс FoodInventory - склад еды по типам питания.
+// Партии каждого типа лежат в очереди FIFO: первой расходуется и первой
+// портится самая старая партия, поэтому все операции затрагивают только
+// начало очереди.
+class FoodInventory {
 public:
-    // Основные атрибуты зоопарка (вариант 1)
-    string name;                // Название зоопарка
-    int day = 0;                // Текущий день
-    int food = 0;               // Количество еды
-    int money = 0;              // Деньги
-    int popularity = 0;         // Популярность (0-100)
-    vector<Animal> animals;     // Все животные
-    vector<Employee> workers;   // Сотрудники
-    vector<Enclosure> enclosures; // Вольеры
+    // Метод добавления партии еды
+    void add(Diet diet, int amount, int expiryDay) {
+        if (amount <= 0) return;
+        lots[(int)diet].push_back({ amount, expiryDay });
+        totals[(int)diet] += amount;
+    }
 
-    // Дополнительные атрибуты (вариант 2)
-    wstring wname;              // Название (unicode)
-    int visitors = 0;           // Количество посетителей
+    // Запас еды одного типа
+    int stock(Diet diet) const { return totals[(int)diet]; }
+
+    // Общий запас еды
+    int total() const { return totals[0] + totals[1]; }
+
+    // Запас еды одного типа, который еще будет годен в день dayNumber
+    int usableOn(Diet diet, int dayNumber) const {
+        int usable = totals[(int)diet];
+        for (const FoodLot& lot : lots[(int)diet]) {
+            if (lot.expiryDay > dayNumber) break;
+            usable -= lot.amount;
+        }
+        return usable;
+    }
+
+    // Метод списания испорченных партий, возвращает количество испорченной еды
+    int expire(int today) {
+        int spoiled = 0;
+        for (int d = 0; d < 2; d++) {
+            while (!lots[d].empty() && lots[d].front().expiryDay <= today) {
+                spoiled += lots[d].front().amount;
+                totals[d] -= lots[d].front().amount;
+                lots[d].pop_front();
+            }
+        }
+        return spoiled;
+    }
+
+    // Метод расхода еды из самых старых партий, возвращает выданное количество
+    int consume(Diet diet, int amount) {
+        deque<FoodLot>& queue = lots[(int)diet];
+        int served = 0;
+        while (served < amount && !queue.empty()) {
+            int portion = min(amount - served, queue.front().amount);
+            queue.front().amount -= portion;
+            served += portion;
+            if (queue.front().amount == 0) queue.pop_front();
+        }
+        totals[(int)diet] -= served;
+        return served;
+    }
+
+private:
+    deque<FoodLot> lots[2];      // Партии по типам питания, от старых к новым
+    int totals[2] = { 0, 0 };    // Общий запас по типам питания
+};
+
+// Структура FoodOrder - оптовый заказ еды, ожидающий доставки
+struct FoodOrder {
+    Diet diet = Diet::HERBIVORES; // Тип еды
+    int amount = 0;               // Количество
+};
+
+// Структура LedgerEntry - одна денежная операция
+struct LedgerEntry {
+    int day = 0;                                      // День операции
+    LedgerCategory category = LedgerCategory::SALARY; // Статья
+    int enclosureId = 0;                              // Вольер (0 - операция всего зоопарка)
+    int amount = 0;                                   // Сумма (доход > 0, расход < 0)
+};
+
+// Класс Ledger - журнал денежных операций зоопарка (только добавление).
+// Операции хранятся по столбцам в блоках фиксированного размера; заполненные
+// блоки общие у копий зоопарка (fork) и не копируются. Для быстрых отчетов
+// ведутся префиксные суммы по дням и статьям (запрос за период - O(1)) и
+// накопленные итоги по вольерам (запрос за период - O(log n)).
+class Ledger {
+public:
+    // Метод записи операции (дни операций не убывают)
+    void record(int day, LedgerCategory category, int enclosureId, int amount) {
+        if (amount == 0) return;
+
+        if (chunks.empty() || chunks.back()->amounts.size() >= LEDGER_CHUNK_SIZE) {
+            chunks.push_back(allocate_shared<Chunk>(TrackingAllocator<Chunk, MemoryTag::LEDGER>()));
+            chunks.back()->reserve(LEDGER_CHUNK_SIZE);
+        }
+        else if (chunks.back().use_count() > 1) {
+            chunks.back() = allocate_shared<Chunk>(TrackingAllocator<Chunk, MemoryTag::LEDGER>(), *chunks.back());
+        }
+        Chunk& chunk = *chunks.back();
+        chunk.days.push_back(day);
+        chunk.categories.push_back((uint8_t)category);
+        chunk.enclosureIds.push_back(enclosureId);
+        chunk.amounts.push_back(amount);
+        count++;
+
+        if (prefix.empty()) prefix.push_back({});
+        while ((int)prefix.size() <= day) prefix.push_back(prefix.back());
+        prefix.back()[(int)category] += amount;
+
+        if (enclosureId != 0) {
+            vector<pair<int, long long>>& series = enclosureTotals[enclosureId];
+            long long running = series.empty() ? 0 : series.back().second;
+            if (!series.empty() && series.back().first == day) series.back().second += amount;
+            else series.push_back({ day, running + amount });
+        }
+    }
+
+    // Количество операций в журнале
+    size_t size() const { return count; }
+
+    // Операция по номеру
+    LedgerEntry entry(size_t position) const {
+        const Chunk& chunk = *chunks[position / LEDGER_CHUNK_SIZE];
+        size_t offset = position % LEDGER_CHUNK_SIZE;
+        return { chunk.days[offset], (LedgerCategory)chunk.categories[offset], chunk.enclosureIds[offset], chunk.amounts[offset] };
+    }
+
+    // Сумма по статье за дни [fromDay, toDay]
+    long long total(LedgerCategory category, int fromDay, int toDay) const {
+        return cumulative(category, toDay) - cumulative(category, fromDay - 1);
+    }
+
+    // Итог по всем статьям за дни [fromDay, toDay]
+    long long net(int fromDay, int toDay) const {
+        long long sum = 0;
+        for (int c = 0; c < (int)LedgerCategory::COUNT; c++) {
+            sum += total((LedgerCategory)c, fromDay, toDay);
+        }
+        return sum;
+    }
+
+    // Прибыль вольера за дни [fromDay, toDay]
+    long long enclosureProfit(int enclosureId, int fromDay, int toDay) const {
+        auto found = enclosureTotals.find(enclosureId);
+        if (found == enclosureTotals.end()) return 0;
+        return runningAt(found->second, toDay) - runningAt(found->second, fromDay - 1);
+    }
+
+private:
+    // Блок операций, хранящийся по столбцам
+    struct Chunk {
+        TrackedVector<int, MemoryTag::LEDGER> days;
+        TrackedVector<uint8_t, MemoryTag::LEDGER> categories;
+        TrackedVector<int, MemoryTag::LEDGER> enclosureIds;
+        TrackedVector<int, MemoryTag::LEDGER> amounts;
+
+        void reserve(size_t size) {
+            days.reserve(size);
+            categories.reserve(size);
+            enclosureIds.reserve(size);
+            amounts.reserve(size);
+        }
+    };
+
+    // Сумма по статье с начала игры по день day включительно
+    long long cumulative(LedgerCategory category, int day) const {
+        if (day < 0 || prefix.empty()) return 0;
+        return prefix[min(day, (int)prefix.size() - 1)][(int)category];
+    }
+
+    // Накопленный итог вольера на конец дня day
+    static long long runningAt(const vector<pair<int, long long>>& series, int day) {
+        auto after = upper_bound(series.begin(), series.end(), day, [](int value, const pair<int, long long>& point) {
+            return value < point.first;
+        });
+        return after == series.begin() ? 0 : prev(after)->second;
+    }
+
+    vector<shared_ptr<Chunk>> chunks;                              // Блоки операций
+    size_t count = 0;                                              // Количество операций
+    TrackedVector<array<long long, (size_t)LedgerCategory::COUNT>, MemoryTag::LEDGER> prefix; // Префиксные суммы по дням и статьям
+    unordered_map<int, vector<pair<int, long long>>> enclosureTotals; // Накопленные итоги по вольерам
+};
+
+// Класс VisitorFlow - симуляция потока посетителей по вольерам.
+// Посетители обрабатываются пакетами, данные пакета лежат в отдельных
+// массивах (состояние генератора, интерес, выбранный вольер, траты),
+// поэтому внутренние циклы без ветвлений векторизуются компилятором.
+// Вольер для остановки выбирается по таблице псевдонимов за O(1).
+class VisitorFlow {
+public:
+    // Метод подготовки маршрутов: веса (привлекательность) вольеров -> таблица псевдонимов
+    // (таблица перестраивается, только если веса изменились со вчерашнего дня)
+    void prepare(const vector<double>& weights) {
+        if (weights == preparedWeights) return;
+        preparedWeights = weights;
+        size_t count = weights.size();
+        double total = 0;
+        for (double weight : weights) total += weight;
+        prob.assign(count, 1.0f);
+        alias.resize(count);
+        for (size_t i = 0; i < count; i++) alias[i] = (uint32_t)i;
+        if (total <= 0) {
+            prob.clear();
+            return;
+        }
+
+        vector<double> scaled(count);
+        vector<uint32_t> small, large;
+        for (size_t i = 0; i < count; i++) {
+            scaled[i] = weights[i] * count / total;
+            (scaled[i] < 1.0 ? small : large).push_back((uint32_t)i);
+        }
+        while (!small.empty() && !large.empty()) {
+            uint32_t lower = small.back(); small.pop_back();
+            uint32_t upper = large.back();
+            prob[lower] = (float)scaled[lower];
+            alias[lower] = upper;
+            scaled[upper] -= 1.0 - scaled[lower];
+            if (scaled[upper] < 1.0) {
+                large.pop_back();
+                small.push_back(upper);
+            }
+        }
+    }
+
+    // Метод симуляции дня: count посетителей делают по VISITOR_STOPS остановок,
+    // траты начисляются в revenue по номерам вольеров
+    void simulate(int count, uint32_t seed, const vector<float>& spendPerStop, vector<double>& revenue) {
+        // Когорты: семьи (две доли из четырех), туристы и школьные группы
+        static const float cohortSpend[4] = { 1.0f, 1.0f, 1.4f, 0.6f };
+
+        revenue.assign(spendPerStop.size(), 0.0);
+        if (prob.empty() || count <= 0) return;
+
+        uint64_t columns = prob.size();
+        state.resize(VISITOR_BATCH);
+        interest.resize(VISITOR_BATCH);
+        choice.resize(VISITOR_BATCH);
+        amount.resize(VISITOR_BATCH);
+        for (int lane = 0; lane < min(count, VISITOR_BATCH); lane++) {
+            state[lane] = GameRandom::mix(seed, lane) | 1;
+        }
+
+        for (int first = 0; first < count; first += VISITOR_BATCH) {
+            int batch = min(VISITOR_BATCH, count - first);
+
+            // Когорта и интерес каждого посетителя пакета
+            for (int i = 0; i < batch; i++) {
+                uint32_t r = step(state[i]);
+                interest[i] = cohortSpend[r & 3] * (0.75f + (float)(int32_t)(r >> 8) * (0.5f / 16777216.0f));
+            }
+
+            for (int stop = 0; stop < VISITOR_STOPS; stop++) {
+                // Выбор вольера: старшая часть произведения - столбец, младшая - монетка
+                for (int i = 0; i < batch; i++) {
+                    uint64_t scaled = (uint64_t)step(state[i]) * columns;
+                    uint32_t column = (uint32_t)(scaled >> 32);
+                    float coin = (float)(int32_t)((uint32_t)scaled >> 8) * (1.0f / 16777216.0f);
+                    uint32_t keep = 0u - (uint32_t)(coin < prob[column]); // Выбор без ветвления
+                    choice[i] = (column & keep) | (alias[column] & ~keep);
+                    amount[i] = interest[i] * spendPerStop[choice[i]];
+                }
+                for (int i = 0; i < batch; i++) {
+                    revenue[choice[i]] += amount[i];
+                }
+            }
+        }
+    }
+
+private:
+    // Шаг генератора xorshift32 для одной дорожки пакета
+    static uint32_t step(uint32_t& value) {
+        value ^= value << 13;
+        value ^= value >> 17;
+        value ^= value << 5;
+        return value;
+    }
+
+    vector<double> preparedWeights; // Веса, по которым построена таблица
+    vector<float> prob;        // Вероятность остаться в столбце таблицы псевдонимов
+    vector<uint32_t> alias;    // Столбец-псевдоним
+    vector<uint32_t> state;    // Состояние генератора каждой дорожки
+    vector<float> interest;    // Интерес (множитель трат) посетителя
+    vector<uint32_t> choice;   // Вольер текущей остановки
+    vector<float> amount;      // Траты на текущей остановке
+};
+
+// Класс LatencyHistogram - гистограмма длительностей без блокировок.
+// Корзина i хранит замеры длительностью меньше 2^i мкс; запись - один атомарный инкремент.
+class LatencyHistogram {
+public:
+    void record(long long nanos) {
+        uint64_t micros = (uint64_t)max(0LL, nanos / 1000);
+        int bucket = 0;
+        while (bucket < LATENCY_BUCKETS - 1 && (1ull << bucket) <= micros) bucket++;
+        buckets[bucket].fetch_add(1, memory_order_relaxed);
+        count.fetch_add(1, memory_order_relaxed);
+        sumNanos.fetch_add(nanos, memory_order_relaxed);
+    }
+
+    // Оценка сверху для квантиля q (в секундах): граница корзины, в которую попал квантиль
+    double quantile(double q) const {
+        long long total = count.load(memory_order_relaxed);
+        if (total == 0) return 0;
+        long long rank = max(1LL, (long long)ceil(q * total));
+        long long seen = 0;
+        for (int i = 0; i < LATENCY_BUCKETS; i++) {
+            seen += buckets[i].load(memory_order_relaxed);
+            if (seen >= rank) return (double)(1ull << i) / 1e6;
+        }
+        return (double)(1ull << (LATENCY_BUCKETS - 1)) / 1e6;
+    }
+
+    long long total() const { return count.load(memory_order_relaxed); }
+    double sumSeconds() const { return sumNanos.load(memory_order_relaxed) / 1e9; }
+
+private:
+    atomic<long long> buckets[LATENCY_BUCKETS] = {}; // Количество замеров по корзинам
+    atomic<long long> count{ 0 };                    // Всего замеров
+    atomic<long long> sumNanos{ 0 };                 // Сумма длительностей
+};
+
+// Структура ZooMetrics - показатели для внешнего мониторинга.
+// Поток симуляции только записывает атомарные значения, поток экспорта их читает.
+struct ZooMetrics {
+    atomic<long long> day{ 0 };             // Текущий день
+    atomic<long long> money{ 0 };           // Деньги
+    atomic<long long> food[2] = {};         // Еда на складе по типам питания
+    atomic<long long> popularity{ 0 };      // Популярность
+    atomic<long long> visitors{ 0 };        // Посетители за последний день
+    atomic<long long> animals[3] = {};      // Животные по состояниям
+    LatencyHistogram tickLatency;           // Длительность дня симуляции
+};
+
+// Класс MetricsExporter - фоновая запись метрик в текстовом формате Prometheus.
+// Файл сначала пишется во временный и затем переименовывается, поэтому
+// читатель никогда не видит наполовину записанный файл.
+class MetricsExporter {
+public:
+    MetricsExporter(const ZooMetrics& _metrics, const filesystem::path& _path) :
+        metrics(_metrics), path(_path), worker([this]() { run(); }) {
+    }
+
+    ~MetricsExporter() {
+        {
+            lock_guard<mutex> lock(guard);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+        write(); // Итоговые значения
+    }
+
+    // Метод записи файла метрик
+    void write() const {
+        static const char* const stateLabels[] = { "healthy", "sick", "dead" };
+        static const char* const dietLabels[] = { "predators", "herbivores" };
+        static const char* const subsystemLabels[] = { "animals", "enclosures", "names", "shop", "ledger", "other" };
+        static const double quantiles[] = { 0.5, 0.9, 0.99 };
+
+        ostringstream text;
+        text << "# TYPE zoo_day gauge\nzoo_day " << metrics.day.load(memory_order_relaxed) << '\n';
+        text << "# TYPE zoo_money gauge\nzoo_money " << metrics.money.load(memory_order_relaxed) << '\n';
+        text << "# TYPE zoo_food gauge\n";
+        for (int d = 0; d < 2; d++) {
+            text << "zoo_food{diet=\"" << dietLabels[d] << "\"} " << metrics.food[d].load(memory_order_relaxed) << '\n';
+        }
+        text << "# TYPE zoo_popularity gauge\nzoo_popularity " << metrics.popularity.load(memory_order_relaxed) << '\n';
+        text << "# TYPE zoo_visitors gauge\nzoo_visitors " << metrics.visitors.load(memory_order_relaxed) << '\n';
+        text << "# TYPE zoo_animals gauge\n";
+        for (int st = 0; st < 3; st++) {
+            text << "zoo_animals{state=\"" << stateLabels[st] << "\"} " << metrics.animals[st].load(memory_order_relaxed) << '\n';
+        }
+
+        text << "# TYPE zoo_tick_seconds summary\n";
+        for (double q : quantiles) {
+            text << "zoo_tick_seconds{quantile=\"" << q << "\"} " << metrics.tickLatency.quantile(q) << '\n';
+        }
+        text << "zoo_tick_seconds_sum " << metrics.tickLatency.sumSeconds() << '\n';
+        text << "zoo_tick_seconds_count " << metrics.tickLatency.total() << '\n';
+
+        text << "# TYPE zoo_memory_live_bytes gauge\n";
+        for (int t = 0; t < (int)MemoryTag::COUNT; t++) {
+            text << "zoo_memory_live_bytes{subsystem=\"" << subsystemLabels[t] << "\"} "
+                << MemoryTracker::of((MemoryTag)t).liveBytes.load(memory_order_relaxed) << '\n';
+        }
+        text << "# TYPE zoo_memory_peak_bytes gauge\n";
+        for (int t = 0; t < (int)MemoryTag::COUNT; t++) {
+            text << "zoo_memory_peak_bytes{subsystem=\"" << subsystemLabels[t] << "\"} "
+                << MemoryTracker::of((MemoryTag)t).peakBytes.load(memory_order_relaxed) << '\n';
+        }
+        text << "# TYPE zoo_memory_allocations_total counter\n";
+        for (int t = 0; t < (int)MemoryTag::COUNT; t++) {
+            text << "zoo_memory_allocations_total{subsystem=\"" << subsystemLabels[t] << "\"} "
+                << MemoryTracker::of((MemoryTag)t).allocations.load(memory_order_relaxed) << '\n';
+        }
+
+        // Запись во временный файл и атомарная замена
+        filesystem::path temporary = path;
+        temporary += ".tmp";
+        {
+            ofstream file(temporary, ios::binary | ios::trunc);
+            if (!file) return;
+            file << text.str();
+            if (!file.flush()) return;
+        }
+        error_code error;
+        filesystem::rename(temporary, path, error);
+    }
+
+private:
+    const ZooMetrics& metrics;  // Читаемые показатели
+    filesystem::path path;      // Файл метрик
+    mutex guard;                // Защита флага остановки
+    condition_variable wake;    // Пробуждение при остановке
+    bool stopping = false;      // Запрошена остановка
+    thread worker;              // Поток периодической записи (объявлен последним)
+
+    // Цикл потока: запись раз в METRICS_INTERVAL_SECONDS секунд
+    void run() {
+        unique_lock<mutex> lock(guard);
+        while (!wake.wait_for(lock, chrono::seconds(METRICS_INTERVAL_SECONDS), [this]() { return stopping; })) {
+            write();
+        }
+    }
+};
+
+// Структура ZooEvent - событие, запланированное на определенный день
+struct ZooEvent {
+    ZooEventType type;  // Тип события
+    int dueDay = 0;     // День срабатывания
+    int period = 0;     // Период повторения в днях (0 - однократное событие)
+    int targetId = 0;   // Идентификатор объекта события (вольер, поколение магазина)
+};
+
+// Класс TimingWheel - иерархическое колесо таймеров для событий зоопарка.
+// Уровень 0 хранит события ближайших 64 дней по одной ячейке на день,
+// уровень 1 - события следующих 64 * 64 дней по ячейке на "эпоху" из 64 дней,
+// все более далекие события лежат в списке переполнения.
+// Стоимость продвижения на день пропорциональна числу сработавших событий.
+class TimingWheel {
+public:
+    int currentDay = 0; // Последний обработанный день
+
+    // Метод планирования события
+    void schedule(ZooEvent event) {
+        if (event.dueDay <= currentDay) event.dueDay = currentDay + 1;
+        place(event);
+        pendingCount++;
+    }
+
+    // Метод продвижения колеса на один день, возвращает события, которые должны сработать
+    vector<ZooEvent> advance() {
+        currentDay++;
+
+        // Перенос событий с верхних уровней при смене эпохи
+        if (currentDay % (TIMING_WHEEL_SLOTS * TIMING_WHEEL_SLOTS) == 0) {
+            cascade(overflow);
+        }
+        if (currentDay % TIMING_WHEEL_SLOTS == 0) {
+            cascade(epochs[(currentDay / TIMING_WHEEL_SLOTS) % TIMING_WHEEL_SLOTS]);
+        }
+
+        vector<ZooEvent> due;
+        due.swap(days[currentDay % TIMING_WHEEL_SLOTS]);
+        pendingCount -= (int)due.size();
+        return due;
+    }
+
+    // Количество ожидающих событий
+    int size() const {
+        return pendingCount;
+    }
+
+private:
+    vector<ZooEvent> days[TIMING_WHEEL_SLOTS];   // Уровень 0: ячейка на день
+    vector<ZooEvent> epochs[TIMING_WHEEL_SLOTS]; // Уровень 1: ячейка на 64 дня
+    vector<ZooEvent> overflow;                   // События дальше 4096 дней
+    int pendingCount = 0;                        // Количество ожидающих событий
+
+    // Размещение события на подходящем уровне колеса
+    void place(const ZooEvent& event) {
+        int dueEpoch = event.dueDay / TIMING_WHEEL_SLOTS;
+        int currentEpoch = currentDay / TIMING_WHEEL_SLOTS;
+        if (dueEpoch == currentEpoch) {
+            days[event.dueDay % TIMING_WHEEL_SLOTS].push_back(event);
+        }
+        else if (dueEpoch / TIMING_WHEEL_SLOTS == currentEpoch / TIMING_WHEEL_SLOTS) {
+            epochs[dueEpoch % TIMING_WHEEL_SLOTS].push_back(event);
+        }
+        else {
+            overflow.push_back(event);
+        }
+    }
+
+    // Перераспределение ячейки верхнего уровня по нижним уровням
+    void cascade(vector<ZooEvent>& bucket) {
+        vector<ZooEvent> moved;
+        moved.swap(bucket);
+        for (const ZooEvent& event : moved) {
+            place(event);
+        }
+    }
+};
+
+// Структура BreedingKey - ключ индекса для подбора пар: вольер, вид и пол
+struct BreedingKey {
+    int enclosureId = 0; // ID вольера
+    wstring species;     // Конкретный вид
+    wchar_t gender = 'M'; // Пол
+
+    bool operator==(const BreedingKey& other) const {
+        return enclosureId == other.enclosureId && gender == other.gender && species == other.species;
+    }
+};
+
+// Хеш-функция для BreedingKey
+struct BreedingKeyHash {
+    size_t operator()(const BreedingKey& key) const {
+        return hash<wstring>()(key.species) ^ ((size_t)key.enclosureId * 0x9E3779B9u + key.gender);
+    }
+};
+
+// Класс ZooIndex - вторичные индексы по животным и вольерам зоопарка.
+// Хранит списки ID животных по состоянию, виду, типу и (вольер, вид, пол),
+// поэтому запросы выполняются за время, пропорциональное размеру ответа.
+// Индексы обновляются при каждом изменении через методы Zoo.
+class ZooIndex {
+public:
+    unordered_set<int> byState[3];                        // ID животных по состоянию здоровья
+    unordered_map<wstring, unordered_set<int>> bySpecies; // ID животных по конкретному виду
+    unordered_map<wstring, unordered_set<int>> byType;    // ID животных по общему типу
+    unordered_map<BreedingKey, unordered_set<int>, BreedingKeyHash> byBreedingKey; // По вольеру, виду и полу
+    unordered_map<int, int> enclosureOf;                  // ID животного -> ID вольера
+    unordered_map<int, size_t> enclosurePosition;         // ID вольера -> номер в списке вольеров
+    unordered_map<wstring, int> enclosureTypeCount;       // Количество вольеров каждого типа
+
+    // Метод добавления животного в индексы
+    void addAnimal(const Animal& animal, int enclosureId) {
+        byState[(int)animal.state].insert(animal.id);
+        bySpecies[animal.specificType()].insert(animal.id);
+        byType[animal.type()].insert(animal.id);
+        byBreedingKey[{ enclosureId, animal.specificType(), animal.gender() }].insert(animal.id);
+        enclosureOf[animal.id] = enclosureId;
+    }
+
+    // Метод удаления животного из индексов
+    void removeAnimal(const Animal& animal) {
+        auto found = enclosureOf.find(animal.id);
+        if (found == enclosureOf.end()) return;
+
+        byState[(int)animal.state].erase(animal.id);
+        eraseId(bySpecies, animal.specificType(), animal.id);
+        eraseId(byType, animal.type(), animal.id);
+        eraseId(byBreedingKey, BreedingKey{ found->second, animal.specificType(), animal.gender() }, animal.id);
+        enclosureOf.erase(found);
+    }
+
+    // Метод смены состояния животного в индексе
+    void changeState(int id, AnimalState from, AnimalState to) {
+        byState[(int)from].erase(id);
+        byState[(int)to].insert(id);
+    }
+
+    // Метод добавления вольера в индексы
+    void addEnclosure(const Enclosure& enclosure, size_t position) {
+        enclosurePosition[enclosure.id] = position;
+        enclosureTypeCount[enclosure.animalType]++;
+    }
+
+    // Метод удаления вольера из индексов (номера вольеров после него сдвигаются на один)
+    void removeEnclosure(const Enclosure& enclosure, const CowVector<Enclosure>& enclosures) {
+        if (--enclosureTypeCount[enclosure.animalType] <= 0) {
+            enclosureTypeCount.erase(enclosure.animalType);
+        }
+        // Сдвигаются только вольеры после удаленного
+        auto removed = enclosurePosition.find(enclosure.id);
+        size_t first = removed->second;
+        enclosurePosition.erase(removed);
+        for (size_t i = first; i < enclosures.size(); i++) {
+            enclosurePosition[enclosures[i].id] = i;
+        }
+    }
+
+    // Количество животных в списке по ключу
+    template <typename Map, typename Key>
+    static size_t countOf(const Map& map, const Key& key) {
+        auto found = map.find(key);
+        return found == map.end() ? 0 : found->second.size();
+    }
+
+    // Количество живых животных
+    int livingCount() const {
+        return (int)(enclosureOf.size() - byState[(int)AnimalState::DEAD].size());
+    }
+
+private:
+    // Удаление ID из списка по ключу (пустые списки удаляются)
+    template <typename Map, typename Key>
+    static void eraseId(Map& map, const Key& key, int id) {
+        auto found = map.find(key);
+        if (found == map.end()) return;
+        found->second.erase(id);
+        if (found->second.empty()) map.erase(found);
+    }
+};
+
+// Класс PlacementEngine - подбор вольеров для партии животных.
+// Для каждого набора ограничений (тип, вид, хищник, климат) хранится список
+// вольеров со свободными местами, поэтому размещение одного животного
+// занимает амортизированно O(1), а не O(число вольеров).
+// Сначала ищется вольер того же климата, затем любой другой.
+// Один подборщик служит целой серии размещений (закупка, рыночный день):
+// новые вольеры и освободившиеся места сообщаются ему через addEnclosure и release.
+class PlacementEngine {
+public:
+    explicit PlacementEngine(const CowVector<Enclosure>& enclosures) {
+        for (size_t i = 0; i < enclosures.size(); i++) {
+            addEnclosure(enclosures[i], i);
+        }
+    }
+
+    // Метод учета вольера, добавленного в зоопарк под номером position
+    void addEnclosure(const Enclosure& enclosure, size_t position) {
+        if (freeSlots.size() <= position) {
+            freeSlots.resize(position + 1, 0);
+            bucketOf.resize(position + 1, nullptr);
+            slotInBucket.resize(position + 1, 0);
+        }
+        freeSlots[position] = enclosure.capacity - enclosure.occupancy();
+        Key key{ enclosure.animalType, enclosure.specificAnimalType, enclosure.isPredatorEnclosure, enclosure.climate };
+        Bucket& bucket = buckets[key];
+        bucketOf[position] = &bucket;
+        slotInBucket[position] = bucket.enclosures.size();
+        bucket.enclosures.push_back((int)position);
+    }
+
+    // Метод освобождения места в вольере (резерв не понадобился или животное ушло)
+    void release(int position) {
+        freeSlots[position]++;
+        Bucket& bucket = *bucketOf[position];
+        bucket.next = min(bucket.next, slotInBucket[position]);
+    }
+
+    // Метод выбора вольера для животного с резервированием места (-1 - места нет)
+    int place(const Animal& animal) {
+        static const Climate climates[] = { Climate::CONTINENT, Climate::TROPIC, Climate::ARCTIC };
+        bool predator = animal.isPredator != 0;
+
+        int found = take({ animal.type(), animal.specificType(), predator, animal.climate });
+        if (found < 0) found = take({ animal.type(), L"", predator, animal.climate });
+        for (Climate climate : climates) {
+            if (found >= 0) break;
+            if (climate == animal.climate) continue;
+            found = take({ animal.type(), animal.specificType(), predator, climate });
+            if (found < 0) found = take({ animal.type(), L"", predator, climate });
+        }
+        return found;
+    }
+
+private:
+    // Набор ограничений вольера
+    struct Key {
+        wstring type;     // Тип животных
+        wstring specific; // Конкретный вид (пусто - любой)
+        bool predator;    // Для хищников ли
+        Climate climate;  // Климат
+
+        bool operator==(const Key& other) const {
+            return predator == other.predator && climate == other.climate && type == other.type && specific == other.specific;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            size_t seed = hash<wstring>()(key.type) * 31 + hash<wstring>()(key.specific);
+            return seed * 7 + (key.predator ? 3 : 0) + (size_t)key.climate;
+        }
+    };
+
+    // Вольеры с одинаковыми ограничениями; заполненные пропускаются указателем next
+    struct Bucket {
+        vector<int> enclosures;
+        size_t next = 0;
+    };
+
+    // Резервирование места в первом незаполненном вольере набора
+    int take(const Key& key) {
+        auto found = buckets.find(key);
+        if (found == buckets.end()) return -1;
+        Bucket& bucket = found->second;
+        while (bucket.next < bucket.enclosures.size() && freeSlots[bucket.enclosures[bucket.next]] <= 0) {
+            bucket.next++;
+        }
+        if (bucket.next == bucket.enclosures.size()) return -1;
+        int position = bucket.enclosures[bucket.next];
+        freeSlots[position]--;
+        return position;
+    }
+
+    unordered_map<Key, Bucket, KeyHash> buckets; // Вольеры по наборам ограничений
+    vector<int> freeSlots;                       // Свободные места по номерам вольеров
+    vector<Bucket*> bucketOf;                    // Набор, в котором лежит вольер
+    vector<size_t> slotInBucket;                 // Место вольера в списке его набора
+};
+
+// Структура AnimalRef - положение животного в зоопарке (номер вольера и номер в вольере)
+struct AnimalRef {
+    int enclosureIndex = 0; // Номер вольера
+    int animalIndex = 0;    // Номер животного в вольере
+};
+
+// Структура BreedingResult - результат размножения без исключений
+struct BreedingResult {
+    BreedingError error = BreedingError::NONE; // Причина отказа
+    Animal offspring;                          // Копия потомка, помещенного в вольер
+
+    explicit operator bool() const { return error == BreedingError::NONE; }
+};
+
+// Структура StaffTask - задача на день для сотрудника
+struct StaffTask {
+    int enclosureId = 0; // ID вольера
+    int priority = 0;    // Приоритет (грязь, число больных, голод)
+};
+
+// Структура StaffAssignment - назначение сотрудника на задачу
+struct StaffAssignment {
+    int worker = 0; // Номер сотрудника
+    int task = 0;   // Номер задачи
+};
+
+// Функция назначения сотрудников на задачи с минимальной стоимостью.
+// Стоимость назначения равна -приоритет * эффективность, поэтому по
+// неравенству перестановок оптимально сопоставить задачи и сотрудников,
+// отсортированных по убыванию: O(n log n) вместо венгерского алгоритма.
+vector<StaffAssignment> assignStaff(const vector<StaffTask>& tasks, vector<int> staff, const vector<Employee>& workers) {
+    vector<int> order(tasks.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+    sort(order.begin(), order.end(), [&](int a, int b) {
+        return tasks[a].priority != tasks[b].priority ? tasks[a].priority > tasks[b].priority : a < b;
+    });
+    sort(staff.begin(), staff.end(), [&](int a, int b) {
+        return workers[a].efficiency != workers[b].efficiency ? workers[a].efficiency > workers[b].efficiency : a < b;
+    });
+
+    vector<StaffAssignment> assignments;
+    size_t count = min(order.size(), staff.size());
+    assignments.reserve(count);
+    for (size_t i = 0; i < count && tasks[order[i]].priority > 0; i++) {
+        assignments.push_back({ staff[i], order[i] });
+    }
+    return assignments;
+}
+
+// Структура BreedingPair - пара для размножения, подобранная планировщиком
+struct BreedingPair {
+    AnimalRef male;          // Самец
+    AnimalRef female;        // Самка
+    int targetEnclosure = 0; // Номер вольера для потомка
+    int score = 0;           // Оценка пары (родство и ценность)
+};
+
+// Структура AnimalQuery - условия отбора и сортировки для списка животных
+struct AnimalQuery {
+    wstring species;          // Конкретный вид (пусто - любой)
+    int enclosureIndex = -1;  // Номер вольера (-1 - любой)
+    bool onlySick = false;    // Только больные
+    bool onlyHungry = false;  // Только голодные
+    bool onlyUnhappy = false; // Только несчастные
+    AnimalSort sort = AnimalSort::NONE; // Порядок вывода
+
+    // Проверка, подходит ли животное под условия
+    bool matches(const Animal& animal) const {
+        if (!species.empty() && animal.specificType() != species) return false;
+        if (onlySick && animal.state != AnimalState::SICK) return false;
+        if (onlyHungry && !animal.isHungry) return false;
+        if (onlyUnhappy && !animal.isUnhappy && animal.happiness >= 50) return false;
+        return true;
+    }
+};
+
+// Шаблон SpscQueue - очередь без блокировок для одного писателя и одного читателя
+// (кольцевой буфер; писатель двигает только tail, читатель - только head)
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Емкость очереди должна быть степенью двойки");
+
+public:
+    // Добавление элемента (false - очередь заполнена)
+    bool push(const T& value) {
+        size_t tailNow = tail.load(memory_order_relaxed);
+        if (tailNow - head.load(memory_order_acquire) == Capacity) return false;
+        items[tailNow & (Capacity - 1)] = value;
+        tail.store(tailNow + 1, memory_order_release);
+        return true;
+    }
+
+    // Извлечение элемента (false - очередь пуста)
+    bool pop(T& value) {
+        size_t headNow = head.load(memory_order_relaxed);
+        if (headNow == tail.load(memory_order_acquire)) return false;
+        value = items[headNow & (Capacity - 1)];
+        head.store(headNow + 1, memory_order_release);
+        return true;
+    }
+
+private:
+    array<T, Capacity> items;             // Кольцевой буфер
+    alignas(64) atomic<size_t> head{ 0 }; // Следующий элемент для чтения
+    alignas(64) atomic<size_t> tail{ 0 }; // Следующее место для записи
+};
+
+// Шаблон SnapshotBuffer - публикация снимков без блокировок (тройная буферизация).
+// Писатель заполняет свой буфер и меняет его местами со средним; читатель забирает
+// средний, только если там новый снимок, поэтому всегда видит целый снимок.
+template <typename T>
+class SnapshotBuffer {
+public:
+    // Буфер писателя для заполнения
+    T& back() {
+        return slots[backIndex];
+    }
+
+    // Публикация заполненного буфера
+    void publish() {
+        int previous = middle.exchange(backIndex | FRESH, memory_order_acq_rel);
+        backIndex = previous & INDEX;
+    }
+
+    // Последний опубликованный снимок (действителен до следующего вызова read)
+    const T& read() {
+        if (middle.load(memory_order_relaxed) & FRESH) {
+            int previous = middle.exchange(frontIndex, memory_order_acq_rel);
+            frontIndex = previous & INDEX;
+        }
+        return slots[frontIndex];
+    }
+
+private:
+    static const int INDEX = 3; // Маска номера буфера
+    static const int FRESH = 4; // Признак нового снимка в среднем буфере
+
+    T slots[3];                 // Буферы писателя, средний и читателя
+    int backIndex = 0;          // Буфер писателя
+    int frontIndex = 1;         // Буфер читателя
+    atomic<int> middle{ 2 };    // Средний буфер и признак новизны
+};
+
+// Структура PlayerCommand - команда игрока для потока симуляции
+struct PlayerCommand {
+    PlayerCommandType type = PlayerCommandType::PAUSE; // Тип команды
+    int first = 0;  // Первый параметр (позиция, тип еды, должность, климат, мс на день)
+    int second = 0; // Второй параметр (количество)
+};
+
+// Структура ZooSnapshot - согласованный снимок зоопарка для интерфейса
+struct ZooSnapshot {
+    vector<wstring> status;   // Строки панели статуса
+    vector<wstring> shop;     // Первая страница магазина
+    deque<wstring> log;       // Последние сообщения симуляции
+    int dayMs = 0;            // Длительность дня
+    bool paused = false;      // Время остановлено
+    bool finished = false;    // Игра закончилась (победа или банкротство)
+};
+
+// Класс ScreenRenderer - дифференциальный вывод панели статуса.
+// Панель рисуется в буфер строк и сравнивается с уже показанной: в терминал уходят
+// только изменившиеся строки (переход курсора, текст, очистка хвоста строки).
+// Панель закреплена в верхних строках экрана, ниже задается область прокрутки,
+// в которой работают меню и сообщения. Если вывод идет не в терминал, панель
+// печатается обычным текстом и только тогда, когда она изменилась.
+class ScreenRenderer {
+public:
+    explicit ScreenRenderer(bool _terminal) : terminal(_terminal) {}
+
+    ~ScreenRenderer() {
+        release();
+    }
+
+    // Включение escape-последовательностей в консоли; false - вывод не в терминал
+    static bool enableTerminal() {
+#ifdef _WIN32
+        HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+        DWORD mode = 0;
+        if (output == INVALID_HANDLE_VALUE || !GetConsoleMode(output, &mode)) return false;
+        return SetConsoleMode(output, mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
+#else
+        return _isatty(_fileno(stdout)) != 0;
+#endif
+    }
+
+    // Вывод кадра панели (лишние строки отбрасываются, недостающие - пустые)
+    void present(const vector<wstring>& frame) {
+        if (!terminal) {
+            if (frame == shown) return;
+            wostringstream buffer;
+            buffer << L'\n';
+            for (const wstring& line : frame) buffer << line << L'\n';
+            wcout << buffer.str();
+            shown = frame;
+            return;
+        }
+
+        wstring output;
+        if (!pinned) {
+            // Очистка экрана, область прокрутки под панелью, курсор в начало этой области
+            output += L"\x1b[2J\x1b[" + to_wstring(STATUS_PANEL_LINES + 1) + L";r";
+            output += L"\x1b[" + to_wstring(STATUS_PANEL_LINES + 1) + L";1H";
+            shown.assign(STATUS_PANEL_LINES, L"\x1b"); // Заведомо отличается от любой строки
+            pinned = true;
+            static bool restoreRegistered = false;
+            if (!restoreRegistered) {
+                atexit([]() { wcout << L"\x1b[r" << flush; }); // exit() из игры не оставит область прокрутки
+                restoreRegistered = true;
+            }
+        }
+
+        output += L"\x1b7"; // Сохранение курсора области прокрутки
+        for (int row = 0; row < STATUS_PANEL_LINES; row++) {
+            const wstring& line = row < (int)frame.size() ? frame[row] : empty;
+            if (line == shown[row]) continue;
+            output += L"\x1b[" + to_wstring(row + 1) + L";1H";
+            output += line;
+            output += L"\x1b[K";
+            shown[row] = line;
+        }
+        output += L"\x1b8"; // Возврат курсора
+        wcout << output << flush;
+    }
+
+    // Снятие закрепления панели (весь экран снова прокручивается)
+    void release() {
+        if (!pinned) return;
+        wcout << L"\x1b[r\x1b[999;1H\n" << flush;
+        pinned = false;
+        shown.clear();
+    }
+
+private:
+    bool terminal;          // Вывод в терминал с escape-последовательностями
+    bool pinned = false;    // Панель закреплена на экране
+    vector<wstring> shown;  // Строки, которые сейчас на экране
+    const wstring empty;    // Пустая строка панели
+};
+
+// Структура AsyncTask - фоновая задача цикла событий. Задача возобновляемая:
+// состояние хранится в замыканиях, и каждый вызов step продвигает ее на один шаг
+struct AsyncTask {
+    function<bool()> step;        // Один шаг; false - задача завершена
+    function<wstring()> progress; // Описание хода выполнения
+    function<void()> finish;      // Итог после завершения или отмены
+};
+
+// Класс EventLoop - цикл событий интерфейса. Ввод читается отдельным потоком
+// построчно; пока строки нет, в точке ожидания главного меню срабатывают таймеры
+// и выполняются шаги фоновых задач. Во вложенных меню задачи стоят на паузе,
+// чтобы номера животных и вольеров не менялись между выводом списка и выбором.
+class EventLoop {
+public:
+    // Единственный цикл программы (не разрушается: поток чтения может быть
+    // заблокирован на вводе до самого выхода)
+    static EventLoop& instance() {
+        static EventLoop* loop = new EventLoop();
+        return *loop;
+    }
+
+    // Чтение строки ввода. Если задан idlePrompt, пока ввода нет, работают таймеры
+    // и фоновые задачи, а после их вывода приглашение печатается заново.
+    // При закрытом вводе игра завершается.
+    wstring readLine(const wchar_t* idlePrompt = nullptr) {
+        startReader();
+        while (true) {
+            if (idlePrompt) runIdle(idlePrompt);
+
+            unique_lock<mutex> lock(inputMutex);
+            if (!lines.empty()) {
+                wstring line = move(lines.front());
+                lines.pop_front();
+                return line;
+            }
+            if (closed) {
+                lock.unlock();
+                wcout << L"\nВвод закрыт, игра завершена.\n";
+                exit(0);
+            }
+            if (idlePrompt && !tasks.empty()) continue;
+            if (idlePrompt && !timers.empty()) {
+                inputReady.wait_until(lock, nextDeadline());
+            }
+            else {
+                inputReady.wait(lock);
+            }
+        }
+    }
+
+    // Чтение непустой строки без начальных пробелов (названия и имена)
+    wstring readText() {
+        while (true) {
+            wstring line = readLine();
+            size_t start = line.find_first_not_of(L" \t\r");
+            if (start != wstring::npos) return line.substr(start);
+        }
+    }
+
+    // Чтение числа (false - в строке не число)
+    bool readInt(int& value, const wchar_t* idlePrompt = nullptr) {
+        wistringstream line(readLine(idlePrompt));
+        return (bool)(line >> value);
+    }
+
+    // Запуск фоновой задачи
+    void spawn(AsyncTask task) {
+        tasks.push_back(move(task));
+        if (progressTimer == 0) {
+            progressTimer = every(chrono::milliseconds(TASK_PROGRESS_MS), [this]() {
+                for (const AsyncTask& running : tasks) wcout << L"\n[фон] " << running.progress() << L'\n';
+            });
+        }
+    }
+
+    // Количество незавершенных фоновых задач
+    size_t taskCount() const {
+        return tasks.size();
+    }
+
+    // Выполнение всех фоновых задач до конца
+    void runToCompletion() {
+        while (!tasks.empty()) {
+            if (!tasks.front().step()) finishFront();
+        }
+    }
+
+    // Отмена всех фоновых задач (итог выводится для уже сделанной части)
+    void cancelAll() {
+        while (!tasks.empty()) finishFront();
+    }
+
+    // Периодический таймер, возвращает его номер
+    int every(chrono::milliseconds period, function<void()> callback) {
+        timers.push_back({ ++lastTimerId, chrono::steady_clock::now() + period, period, move(callback) });
+        return lastTimerId;
+    }
+
+    // Удаление таймера
+    void cancelTimer(int id) {
+        timers.erase(remove_if(timers.begin(), timers.end(), [id](const Timer& timer) { return timer.id == id; }), timers.end());
+    }
+
+private:
+    // Структура Timer - периодический таймер цикла событий
+    struct Timer {
+        int id;                               // Номер таймера
+        chrono::steady_clock::time_point due; // Время следующего срабатывания
+        chrono::milliseconds period;          // Период
+        function<void()> callback;            // Действие
+    };
+
+    EventLoop() = default;
+
+    // Запуск потока чтения при первом обращении к вводу
+    void startReader() {
+        if (readerStarted) return;
+        readerStarted = true;
+        thread([this]() {
+            wstring line;
+            while (getline(wcin, line)) {
+                lock_guard<mutex> lock(inputMutex);
+                lines.push_back(move(line));
+                inputReady.notify_one();
+            }
+            lock_guard<mutex> lock(inputMutex);
+            closed = true;
+            inputReady.notify_one();
+        }).detach();
+    }
+
+    // Есть ли ввод, который нужно обработать
+    bool hasInput() {
+        lock_guard<mutex> lock(inputMutex);
+        return !lines.empty() || closed;
+    }
+
+    // Ближайшее срабатывание таймера
+    chrono::steady_clock::time_point nextDeadline() const {
+        auto deadline = chrono::steady_clock::time_point::max();
+        for (const Timer& timer : timers) deadline = min(deadline, timer.due);
+        return deadline;
+    }
+
+    // Таймеры и отрезок работы фоновых задач в точке ожидания
+    void runIdle(const wchar_t* prompt) {
+        size_t printedBefore = printed;
+        auto now = chrono::steady_clock::now();
+        for (size_t i = 0; i < timers.size(); i++) {
+            if (timers[i].due > now) continue;
+            timers[i].due = now + timers[i].period;
+            timers[i].callback();
+            printed++;
+        }
+
+        // Хотя бы один отрезок на каждое ожидание, даже если ввод уже есть
+        auto sliceEnd = now + chrono::milliseconds(TASK_SLICE_MS);
+        while (!tasks.empty()) {
+            for (auto task = tasks.begin(); task != tasks.end();) {
+                if (task->step()) {
+                    ++task;
+                    continue;
+                }
+                task->finish();
+                task = tasks.erase(task);
+                printed++;
+            }
+            if (chrono::steady_clock::now() >= sliceEnd || hasInput()) break;
+        }
+        if (tasks.empty() && progressTimer != 0) {
+            cancelTimer(progressTimer);
+            progressTimer = 0;
+        }
+        if (printed != printedBefore) wcout << prompt;
+    }
+
+    // Завершение первой задачи в списке
+    void finishFront() {
+        tasks.front().finish();
+        tasks.pop_front();
+        if (tasks.empty() && progressTimer != 0) {
+            cancelTimer(progressTimer);
+            progressTimer = 0;
+        }
+    }
+
+    mutex inputMutex;                 // Защита очереди строк
+    condition_variable inputReady;    // Сигнал о новой строке или закрытии ввода
+    deque<wstring> lines;             // Прочитанные, но не обработанные строки
+    bool closed = false;              // Ввод закрыт
+    bool readerStarted = false;       // Поток чтения запущен
+    list<AsyncTask> tasks;            // Фоновые задачи (только поток интерфейса)
+    vector<Timer> timers;             // Таймеры (только поток интерфейса)
+    int lastTimerId = 0;              // Последний выданный номер таймера
+    int progressTimer = 0;            // Таймер вывода хода задач
+    size_t printed = 0;               // Счетчик вывода в точках ожидания
+};
+
+// Класс Zoo - основной класс, представляющий зоопарк
+class Zoo {
+public:
+    // Основные атрибуты зоопарка (вариант 1)
+    NameHandle name;            // Название зоопарка (в общем пуле имен)
+    int day = 0;                // Текущий день
+    FoodInventory pantry;       // Склад еды по типам питания
+    unordered_map<int, FoodOrder> foodOrders; // Оптовые заказы еды в пути (по ID заказа)
+    int nextFoodOrderId = 1;    // Идентификатор для следующего заказа еды
+    int money = 0;              // Деньги (изменяются только через spend и earn)
+    Ledger ledger;              // Журнал денежных операций
+    VisitorFlow visitorFlow;    // Симуляция посетителей
+    int popularity = 0;         // Популярность (0-100)
+    vector<Employee> workers;   // Сотрудники
+    CowVector<Enclosure> enclosures; // Вольеры (общие с ветками fork до первого изменения)
+
+    // Дополнительные атрибуты (вариант 2)
+    int visitors = 0;           // Количество посетителей
     int animalsCount = 0;       // Количество животных
     int daysSurvived = 0;       // Дней выживания
     bool hasPlayerTakenAction = false; // Игрок совершил действие
     bool delegationSatisfied = false; // Довольна ли делегация
     int daysWithoutAction = 0;  // Дней без действий
     int animalsBoughtToday = 0; // Животных куплено сегодня
-
-    // Вложенная структура для магазина животных
+    int dailyExpenses = 0;      // Расходы текущего дня
+    int nextEnclosureId = 1;    // Идентификатор для следующего вольера
+    int nextAnimalId = 1;       // Идентификатор для следующего животного
+    int lastBreedingDay = 0;    // День последнего размножения по плану
+    TimingWheel scheduler;      // Планировщик периодических событий
+    shared_ptr<ZooIndex> zooIndex = make_shared<ZooIndex>(); // Вторичные индексы (общие с ветками fork до изменения)
+    StateDigest stateDigest;    // Инкрементальный хэш животных и вольеров
+    ZooMetrics* metrics = nullptr; // Показатели для экспорта метрик (nullptr - экспорт выключен)
+    GameRandom rng;             // Собственный генератор случайных чисел зоопарка
+    bool silent = false;        // Не выводить сообщения (симуляция мира)
+    bool sandbox = false;       // Без победы и выхода из программы при банкротстве
+    bool bankrupt = false;      // Зоопарк обанкротился (только в режиме sandbox)
+    int herdLiving = 0;         // Животных в стадах всех вольеров
+    int herdSick = 0;           // Из них больных
+
+    // Вложенная структура для магазина животных.
+    // Ассортимент хранится как зерно и номера позиций, а сами животные
+    // генерируются при первом просмотре или покупке и кэшируются (LRU).
     struct AnimalShop {
-        vector<Animal> availableAnimals; // Доступные животные
+        uint32_t seed = 0;               // Зерно текущего ассортимента
+        TrackedVector<int, MemoryTag::SHOP> listings; // Номера еще не проданных позиций
+        list<pair<int, Animal>, TrackingAllocator<pair<int, Animal>, MemoryTag::SHOP>> cache; // Материализованные позиции, недавние - в начале
         int daysUntilRefresh = 0;        // Дней до обновления
+        int generation = 0;              // Номер текущего ассортимента
+
+        // Замена ассортимента (животные не создаются)
+        void restock(uint32_t newSeed, int count) {
+            seed = newSeed;
+            listings.clear();
+            for (int i = 0; i < count; i++) {
+                listings.push_back(i);
+            }
+            cache.clear();
+        }
+
+        size_t size() const {
+            return listings.size();
+        }
+
+        bool empty() const {
+            return listings.empty();
+        }
+
+        // Получение животного на позиции (генерируется при первом обращении)
+        const Animal& get(size_t position) {
+            int listing = listings[position];
+            for (auto it = cache.begin(); it != cache.end(); ++it) {
+                if (it->first == listing) {
+                    cache.splice(cache.begin(), cache, it);
+                    return cache.front().second;
+                }
+            }
+
+            cache.emplace_front(listing, generateShopAnimal(GameRandom::mix(seed, listing)));
+            if ((int)cache.size() > SHOP_CACHE_SIZE) {
+                cache.pop_back();
+            }
+            return cache.front().second;
+        }
+
+        // Снятие животного с продажи
+        Animal take(size_t position) {
+            Animal animal = get(position);
+            cache.pop_front();
+            listings.erase(listings.begin() + position);
+            return animal;
+        }
+
+        // Все доступные животные (для вывода списка). Список длиннее кэша, поэтому
+        // животные создаются мимо кэша и не вытесняют из него выбранные позиции.
+        vector<Animal> snapshot() const {
+            vector<Animal> result;
+            result.reserve(listings.size());
+            for (int listing : listings) {
+                auto cached = find_if(cache.begin(), cache.end(), [&](const pair<int, Animal>& entry) { return entry.first == listing; });
+                result.push_back(cached != cache.end() ? cached->second : generateShopAnimal(GameRandom::mix(seed, listing)));
+            }
+            return result;
+        }
     } animalShop;
 
     // Конструктор с параметрами (английская версия)
-    Zoo(string _name, int start_money) :
-        name(_name), day(0), food(0), money(start_money), popularity(50),
+    Zoo(string _name, int start_money, uint32_t seed) :
+        name(NameHandle::of(NamePool::fromUtf8(_name.data(), _name.size()))), day(0), money(start_money), popularity(50),
         visitors(0), animalsCount(0), daysSurvived(0),
         hasPlayerTakenAction(false), delegationSatisfied(false),
-        daysWithoutAction(0), animalsBoughtToday(0) {
+        daysWithoutAction(0), animalsBoughtToday(0), rng(seed) {
 
         animalShop.daysUntilRefresh = 0;
         refreshAnimalShop();
+        scheduleDailyEvents();
         // Добавление директора по умолчанию
-        workers.push_back(Employee("Директор Егор", 100, WorkerRole::DIRECTOR));
+        workers.push_back(Employee(NameHandle::of(L"Директор Егор"), 100, WorkerRole::DIRECTOR));
     }
 
     // Конструктор с параметрами (локализованная версия)
-    Zoo(wstring _wname) : wname(_wname), food(10), money(100000), popularity(50),
+    Zoo(wstring _wname, uint32_t seed) : name(NameHandle::of(_wname)), money(100000), popularity(50),
         visitors(0), animalsCount(0), daysSurvived(0), day(0),
         hasPlayerTakenAction(false), delegationSatisfied(false),
-        daysWithoutAction(0), animalsBoughtToday(0) {
+        daysWithoutAction(0), animalsBoughtToday(0), rng(seed) {
 
         animalShop.daysUntilRefresh = 0;
         refreshAnimalShop();
+        scheduleDailyEvents();
         // Добавление директора по умолчанию
-        workers.push_back(Employee("Директор Егор", 100, WorkerRole::DIRECTOR));
-        name = string(_wname.begin(), _wname.end());
+        workers.push_back(Employee(NameHandle::of(L"Директор Егор"), 100, WorkerRole::DIRECTOR));
+        pantry.add(Diet::PREDATORS, 5, FOOD_SHELF_LIFE);
+        pantry.add(Diet::HERBIVORES, 5, FOOD_SHELF_LIFE);
+    }
+
+    // Метод расхода денег с записью в журнал
+    void spend(LedgerCategory category, int amount, int enclosureId = 0) {
+        money -= amount;
+        ledger.record(day, category, enclosureId, -amount);
+    }
+
+    // Метод получения денег с записью в журнал
+    void earn(LedgerCategory category, int amount, int enclosureId = 0) {
+        money += amount;
+        ledger.record(day, category, enclosureId, amount);
+    }
+
+    // Поток для сообщений зоопарка (в тихом режиме вывод отбрасывается)
+    wostream& out() {
+        static thread_local wostream nullStream(nullptr);
+        return silent ? nullStream : wcout;
+    }
+
+    // Метод регистрации ежедневных событий в планировщике
+    void scheduleDailyEvents() {
+        scheduler.schedule({ ZooEventType::WORKER_REST, day + 1, 1, 0 });
+        scheduler.schedule({ ZooEventType::SALARY_PAYMENT, day + 1, 1, 0 });
+    }
+
+    // Метод получения индексов для изменения (отделяет их от веток fork)
+    ZooIndex& writeIndex() {
+        if (zooIndex.use_count() > 1) {
+            zooIndex = make_shared<ZooIndex>(*zooIndex);
+        }
+        return *zooIndex;
+    }
+
+    // Метод добавления вольера в зоопарк (назначает ID и планирует уборку)
+    Enclosure& addEnclosure(const Enclosure& enclosure) {
+        enclosures.push_back(enclosure);
+        Enclosure& added = enclosures.back();
+        added.id = nextEnclosureId++;
+        stateDigest.toggle(StateDigest::enclosure(added));
+        writeIndex().addEnclosure(added, enclosures.size() - 1);
+        scheduler.schedule({ ZooEventType::ENCLOSURE_CLEANING, day + added.daysUntilCleaning(), 0, added.id });
+        return added;
+    }
+
+    // Метод удаления пустого вольера из зоопарка
+    void removeEnclosureAt(size_t position) {
+        Enclosure removed = as_const(enclosures)[position];
+        stateDigest.toggle(StateDigest::enclosure(removed));
+        enclosures.erase(enclosures.begin() + position);
+        writeIndex().removeEnclosure(removed, enclosures);
+    }
+
+    // Метод поиска вольера по ID
+    Enclosure* findEnclosure(int id) {
+        auto found = zooIndex->enclosurePosition.find(id);
+        if (found == zooIndex->enclosurePosition.end()) return nullptr;
+        return &enclosures[found->second];
+    }
+
+    // Метод помещения животного в вольер с обновлением индексов
+    void placeAnimal(Enclosure& enclosure, const Animal& animal) {
+        enclosure.animals.push_back(animal);
+        if (animal.isHungry) enclosure.mayBeHungry[(int)animal.diet] = true;
+        if (animal.state != AnimalState::DEAD) enclosure.countLiving(animal, 1);
+        writeIndex().addAnimal(animal, enclosure.id);
+        stateDigest.toggle(StateDigest::animal(enclosure.id, animal));
+    }
+
+    // Метод удаления животного из вольера с обновлением индексов
+    void removeAnimalAt(Enclosure& enclosure, size_t position) {
+        Animal animal = as_const(enclosure.animals)[position];
+        if (animal.state != AnimalState::DEAD) enclosure.countLiving(animal, -1);
+        writeIndex().removeAnimal(animal);
+        stateDigest.toggle(StateDigest::animal(enclosure.id, animal));
+        enclosure.animals.erase(position);
+    }
+
+    // Метод удаления животного из вольера по ID
+    bool removeAnimalById(Enclosure& enclosure, int id) {
+        int position = enclosure.findAnimal(id);
+        if (position < 0) return false;
+        removeAnimalAt(enclosure, position);
+        return true;
+    }
+
+    // Метод смены состояния животного с обновлением индексов
+    void setAnimalState(Enclosure& enclosure, size_t position, AnimalState state) {
+        AnimalVitals& animal = enclosure.animals.vitals(position);
+        if (animal.state == state) return;
+        if (state == AnimalState::DEAD) enclosure.countLiving(animal, -1);
+        if (animal.state == AnimalState::DEAD) enclosure.countLiving(animal, 1);
+        writeIndex().changeState(animal.id, animal.state, state);
+        uint64_t before = StateDigest::animal(enclosure.id, animal);
+        animal.state = state;
+        stateDigest.replace(before, StateDigest::animal(enclosure.id, animal));
+    }
+
+    // Метод обработки события планировщика
+    void processEvent(const ZooEvent& event) {
+        switch (event.type) {
+        case ZooEventType::WORKER_REST:
+            for (auto& worker : workers) {
+                worker.update();
+            }
+            break;
+        case ZooEventType::SALARY_PAYMENT: {
+            int cost = 0;
+            for (Employee& worker : workers) { cost += worker.price; }
+            spend(LedgerCategory::SALARY, cost);
+            dailyExpenses += cost;
+            break;
+        }
+        case ZooEventType::SHOP_REFRESH:
+            // Устаревшие события (магазин обновили вручную) пропускаются
+            if (event.targetId == animalShop.generation) {
+                refreshAnimalShop();
+            }
+            break;
+        case ZooEventType::ENCLOSURE_CLEANING:
+            // Уборка обрабатывается отдельно, после загрязнения вольеров
+            break;
+        case ZooEventType::FOOD_DELIVERY: {
+            auto order = foodOrders.find(event.targetId);
+            if (order != foodOrders.end()) {
+                pantry.add(order->second.diet, order->second.amount, day + FOOD_SHELF_LIFE);
+                out() << L"Доставлен заказ: " << foodName(order->second.diet) << L" " << order->second.amount << endl;
+                foodOrders.erase(order);
+            }
+            break;
+        }
+        }
+
+        if (event.period > 0) {
+            ZooEvent next = event;
+            next.dueDay += event.period;
+            scheduler.schedule(next);
+        }
+    }
+
+    // Метод распределения персонала на день: уборщики убирают вольеры, у которых
+    // наступил срок уборки, ветеринары лечат вольеры с больными, смотрители
+    // ухаживают за голодными и несчастными животными. Сотрудники с большей
+    // эффективностью получают задачи с большим приоритетом.
+    void runWorkforce(const vector<ZooEvent>& events, bool report = true) {
+        vector<int> cleaners, vets, caretakers;
+        for (size_t i = 0; i < workers.size(); i++) {
+            const Employee& worker = workers[i];
+            if (worker.tired) continue;
+            switch (worker.role) {
+            case WorkerRole::CLEANER: cleaners.push_back((int)i); break;
+            case WorkerRole::VETERINAR: vets.push_back((int)i); break;
+            case WorkerRole::FOODMEN: caretakers.push_back((int)i); break;
+            default: break;
+            }
+        }
+
+        // Уборка: задачи - вольеры со сработавшим событием, приоритет - уровень грязи
+        vector<StaffTask> cleaning;
+        for (const ZooEvent& event : events) {
+            if (event.type != ZooEventType::ENCLOSURE_CLEANING) continue;
+            Enclosure* enclosure = findEnclosure(event.targetId);
+            if (enclosure == nullptr) continue; // Вольер уже продан
+            cleaning.push_back({ enclosure->id, enclosure->needsCleaning() ? enclosure->dirty : 0 });
+        }
+        int cleaned = 0;
+        for (const StaffAssignment& assignment : assignStaff(cleaning, cleaners, workers)) {
+            Enclosure& enclosure = *findEnclosure(cleaning[assignment.task].enclosureId);
+            uint64_t before = StateDigest::enclosure(enclosure);
+            enclosure.clean(workers[assignment.worker].efficiency);
+            stateDigest.replace(before, StateDigest::enclosure(enclosure));
+            cleaned++;
+        }
+        for (const StaffTask& task : cleaning) {
+            // Если уборщиков не хватило, попытка повторится завтра
+            Enclosure* enclosure = findEnclosure(task.enclosureId);
+            int delay = max(1, enclosure->daysUntilCleaning());
+            scheduler.schedule({ ZooEventType::ENCLOSURE_CLEANING, day + delay, 0, enclosure->id });
+        }
+
+        // Лечение: задачи - вольеры с больными (отдельные животные и стада), приоритет - число больных
+        int healed = treatSick(vets);
+
+        // Уход: приоритет - голодные животные и недостаток счастья в вольере.
+        // Голодное животное смотритель кормит дополнительной порцией со склада;
+        // если еды нет, животное остается голодным.
+        int caredFor = 0;
+        if (!caretakers.empty()) {
+            vector<StaffTask> care;
+            for (const Enclosure& enclosure : as_const(enclosures)) {
+                int priority = 0;
+                for (const AnimalVitals& animal : enclosure.animals.allVitals()) {
+                    if (animal.state == AnimalState::DEAD) continue;
+                    priority += (animal.isHungry ? 100 : 0) + max(0, 100 - animal.happiness);
+                }
+                care.push_back({ enclosure.id, priority });
+            }
+            for (const StaffAssignment& assignment : assignStaff(care, caretakers, workers)) {
+                Enclosure& enclosure = *findEnclosure(care[assignment.task].enclosureId);
+                int boost = workers[assignment.worker].efficiency / 10;
+                for (AnimalVitals& animal : enclosure.animals.allVitals()) {
+                    if (animal.state == AnimalState::DEAD) continue;
+                    uint64_t before = StateDigest::animal(enclosure.id, animal);
+                    if (animal.isHungry && pantry.stock(animal.diet) >= FOOD_PER_ANIMAL) {
+                        pantry.consume(animal.diet, FOOD_PER_ANIMAL);
+                        animal.isHungry = false;
+                    }
+                    enclosure.happinessSum -= animal.happiness;
+                    animal.happiness = min(100, animal.happiness + boost);
+                    enclosure.happinessSum += animal.happiness;
+                    animal.isUnhappy = animal.happiness < 50;
+                    stateDigest.replace(before, StateDigest::animal(enclosure.id, animal));
+                    caredFor++;
+                }
+            }
+        }
+
+        if (!report) return;
+        out() << L"Персонал: убрано вольеров " << cleaned << L", вылечено " << healed << L", обслужено животных " << caredFor << endl;
+    }
+
+    // Метод расчета дневной потребности в еде по типам питания (O(число вольеров))
+    void foodDemand(int demand[2]) const {
+        demand[0] = demand[1] = 0;
+        for (const Enclosure& enclosure : enclosures) {
+            demand[0] += enclosure.eaters[0] * FOOD_PER_ANIMAL;
+            demand[1] += enclosure.eaters[1] * FOOD_PER_ANIMAL;
+        }
+    }
+
+    // Метод проверки, что еды каждого типа хватит на день dayNumber
+    bool hasFoodFor(int dayNumber) const {
+        int demand[2];
+        foodDemand(demand);
+        return pantry.usableOn(Diet::PREDATORS, dayNumber) >= demand[0] &&
+            pantry.usableOn(Diet::HERBIVORES, dayNumber) >= demand[1];
+    }
+
+    // Метод кормления за один проход по вольерам: каждый вольер получает еду
+    // своего типа из самых старых партий. Если еды не хватило, животные
+    // вольера голодают и умирают с вероятностью 10%. Возвращает выданную еду.
+    int feedEnclosures() {
+        int served = 0;
+        for (size_t e = 0; e < enclosures.size(); e++) {
+            for (int d = 0; d < 2; d++) {
+                int need = as_const(enclosures)[e].eaters[d] * FOOD_PER_ANIMAL;
+                if (need == 0) continue;
+                int portion = pantry.consume((Diet)d, need);
+                served += portion;
+                if (portion < need) starveEnclosure(enclosures[e], (Diet)d);
+                else if (as_const(enclosures)[e].mayBeHungry[d]) satisfyEnclosure(enclosures[e], (Diet)d);
+            }
+        }
+        return served;
+    }
+
+    // Метод снятия голода с животных одного типа питания в вольере после полного кормления
+    void satisfyEnclosure(Enclosure& enclosure, Diet diet) {
+        for (size_t i = 0; i < enclosure.animals.size(); i++) {
+            AnimalVitals animal = as_const(enclosure.animals).vitals(i);
+            if (!animal.isHungry || animal.diet != diet) continue;
+            uint64_t before = StateDigest::animal(enclosure.id, animal);
+            enclosure.animals.vitals(i).isHungry = false;
+            stateDigest.replace(before, StateDigest::animal(enclosure.id, as_const(enclosure.animals).vitals(i)));
+        }
+        enclosure.mayBeHungry[(int)diet] = false;
+    }
+
+    // Метод голодания животных одного типа питания в вольере
+    void starveEnclosure(Enclosure& enclosure, Diet diet) {
+        enclosure.mayBeHungry[(int)diet] = true;
+        for (size_t i = 0; i < enclosure.animals.size(); i++) {
+            AnimalVitals animal = as_const(enclosure.animals).vitals(i);
+            if (animal.state == AnimalState::DEAD || animal.diet != diet) continue;
+            if (!animal.isHungry) {
+                uint64_t before = StateDigest::animal(enclosure.id, animal);
+                enclosure.animals.vitals(i).isHungry = true;
+                stateDigest.replace(before, StateDigest::animal(enclosure.id, as_const(enclosure.animals).vitals(i)));
+            }
+            if (rng.range(10) == 0) {
+                out() << L"ID: " << animal.id << L" | Имя: " << as_const(enclosure.animals).record(i).name << L" умерло от голода.\n";
+                setAnimalState(enclosure, i, AnimalState::DEAD);
+            }
+        }
+
+        // В стадах голодная смерть разыгрывается одной выборкой на стадо
+        if (enclosure.cohorts.empty()) return;
+        uint64_t before = StateDigest::enclosure(enclosure);
+        int died = 0;
+        for (size_t c = enclosure.cohorts.size(); c-- > 0;) {
+            const Cohort& cohort = enclosure.cohorts[c];
+            if (cohort.prototype.diet != diet) continue;
+            int healthyDeaths = rng.binomial(cohort.healthy, 10);
+            int sickDeaths = rng.binomial(cohort.sick, 10);
+            died += healthyDeaths + sickDeaths;
+            changeCohort(enclosure, c, -healthyDeaths, -sickDeaths);
+        }
+        stateDigest.replace(before, StateDigest::enclosure(enclosure));
+        if (died > 0) out() << L"В стадах вольера \"" << enclosure.name << L"\" умерло от голода: " << died << endl;
+    }
+
+    // Метод изменения численности стада: счетчики кормления и зоопарка меняются вместе
+    // с ним, опустевшее стадо удаляется (хэш вольера обновляет вызывающий)
+    void changeCohort(Enclosure& enclosure, size_t position, int healthyDelta, int sickDelta) {
+        Cohort& cohort = enclosure.cohorts[position];
+        cohort.healthy += healthyDelta;
+        cohort.sick += sickDelta;
+        enclosure.countLiving(cohort.prototype, healthyDelta + sickDelta);
+        herdLiving += healthyDelta + sickDelta;
+        herdSick += sickDelta;
+        animalsCount += healthyDelta + sickDelta;
+        if (cohort.living() == 0) {
+            enclosure.cohorts.erase(enclosure.cohorts.begin() + position);
+        }
+    }
+
+    // Метод добавления животных в стадо вольера (подходящее стадо или новое)
+    void addToHerd(Enclosure& enclosure, const Animal& animal, int count) {
+        uint64_t before = StateDigest::enclosure(enclosure);
+        size_t position = 0;
+        while (position < enclosure.cohorts.size() && !enclosure.cohorts[position].accepts(animal)) {
+            position++;
+        }
+        if (position == enclosure.cohorts.size()) {
+            Cohort cohort;
+            cohort.prototype = animal;
+            cohort.prototype.id = 0;
+            cohort.prototype.state = AnimalState::HEALTHY;
+            enclosure.cohorts.push_back(cohort);
+        }
+        changeCohort(enclosure, position, count, 0);
+        stateDigest.replace(before, StateDigest::enclosure(enclosure));
+    }
+
+    // Метод выделения одного животного из стада в отдельную запись: животное получает
+    // свой ID, имя и слегка измененные гены. Возвращает номер животного в вольере.
+    size_t promoteFromHerd(Enclosure& enclosure, size_t position) {
+        uint64_t before = StateDigest::enclosure(enclosure);
+        const Cohort& cohort = enclosure.cohorts[position];
+        bool sick = rng.range(cohort.living()) < cohort.sick;
+        Animal animal = cohort.prototype;
+        animal.id = nextAnimalId++;
+        animal.state = sick ? AnimalState::SICK : AnimalState::HEALTHY;
+        animal.genome = Genome::cross(cohort.prototype.genome, cohort.prototype.genome, rng);
+        animal.name = NameHandle::of(cohort.prototype.name.str() + L" " + to_wstring(animal.id));
+        changeCohort(enclosure, position, sick ? 0 : -1, sick ? -1 : 0);
+        stateDigest.replace(before, StateDigest::enclosure(enclosure));
+
+        placeAnimal(enclosure, animal);
+        animalsCount++;
+        return enclosure.animals.size() - 1;
+    }
+
+    // Метод обхода больных ветеринарами vets (номера в workers): задачи - вольеры с больными
+    // (отдельные животные и стада), приоритет - число больных. Каждый ветеринар лечит в своем
+    // вольере до VET_DAILY_PATIENTS * эффективность / 100 животных. Ветеринары, получившие
+    // вольер, попадают в worked. Возвращает число вылеченных.
+    int treatSick(const vector<int>& vets, vector<int>* worked = nullptr, bool report = false) {
+        if (vets.empty() || getCountSickAnimal() == 0) return 0;
+        unordered_map<int, int> sickPerEnclosure;
+        for (int id : zooIndex->byState[(int)AnimalState::SICK]) {
+            sickPerEnclosure[zooIndex->enclosureOf.at(id)]++;
+        }
+        if (herdSick > 0) {
+            for (const Enclosure& enclosure : as_const(enclosures)) {
+                int sick = enclosure.herdSick();
+                if (sick > 0) sickPerEnclosure[enclosure.id] += sick;
+            }
+        }
+        vector<StaffTask> treatment;
+        for (const auto& entry : sickPerEnclosure) {
+            treatment.push_back({ entry.first, entry.second });
+        }
+        sort(treatment.begin(), treatment.end(), [](const StaffTask& a, const StaffTask& b) {
+            return a.enclosureId < b.enclosureId;
+        });
+
+        int healed = 0;
+        for (const StaffAssignment& assignment : assignStaff(treatment, vets, workers)) {
+            Enclosure& enclosure = *findEnclosure(treatment[assignment.task].enclosureId);
+            int patients = max(1, VET_DAILY_PATIENTS * workers[assignment.worker].efficiency / 100);
+            int healedHere = 0;
+            for (size_t i = 0; i < enclosure.animals.size() && patients > 0; i++) {
+                if (as_const(enclosure.animals).vitals(i).state != AnimalState::SICK) continue;
+                setAnimalState(enclosure, i, AnimalState::HEALTHY);
+                patients--;
+                healedHere++;
+            }
+            healedHere += treatHerds(enclosure, patients);
+            healed += healedHere;
+            if (worked != nullptr) worked->push_back(assignment.worker);
+            if (report) {
+                out() << L"Ветеринар " << workers[assignment.worker].name << L" вылечил в вольере \"" << enclosure.name
+                    << L"\": " << healedHere << endl;
+            }
+        }
+        return healed;
+    }
+
+    // Метод лечения больных в стадах вольера ветеринаром, у которого осталось patients
+    // мест: каждый больной выздоравливает с вероятностью COHORT_RECOVERY_PERCENT,
+    // но не больше, чем ветеринар успевает принять. Возвращает число вылеченных.
+    int treatHerds(Enclosure& enclosure, int patients) {
+        if (patients <= 0 || enclosure.cohorts.empty()) return 0;
+        uint64_t before = StateDigest::enclosure(enclosure);
+        int healed = 0;
+        for (size_t c = 0; c < enclosure.cohorts.size() && patients > 0; c++) {
+            int recovered = min(patients, rng.binomial(enclosure.cohorts[c].sick, COHORT_RECOVERY_PERCENT));
+            changeCohort(enclosure, c, recovered, -recovered);
+            patients -= recovered;
+            healed += recovered;
+        }
+        stateDigest.replace(before, StateDigest::enclosure(enclosure));
+        return healed;
+    }
+
+    // Метод ежедневного обновления стад: заражение, старение и смерть
+    // разыгрываются биномиальными выборками, поэтому стоимость дня - O(число стад)
+    void updateHerds() {
+        if (herdLiving == 0) return;
+
+        int infectedTotal = 0;
+        int diedTotal = 0;
+        for (size_t e = 0; e < enclosures.size(); e++) {
+            if (as_const(enclosures)[e].cohorts.empty()) continue;
+            Enclosure& enclosure = enclosures[e];
+            uint64_t before = StateDigest::enclosure(enclosure);
+
+            int sickInside = enclosure.herdSick();
+            for (const AnimalVitals& animal : as_const(enclosure.animals).allVitals()) {
+                sickInside += animal.state == AnimalState::SICK ? 1 : 0;
+            }
+
+            for (size_t c = enclosure.cohorts.size(); c-- > 0;) {
+                Cohort& cohort = enclosure.cohorts[c];
+
+                // Заражение от больных соседей (лечат стада ветеринары в runWorkforce)
+                bool immune = cohort.prototype.genome.trait(Genome::RESISTANCE) >= IMMUNE_RESISTANCE;
+                int infected = sickInside > 0 && !immune ? rng.binomial(cohort.healthy, COHORT_INFECTION_PERCENT) : 0;
+                changeCohort(enclosure, c, -infected, infected);
+                infectedTotal += infected;
+
+                // Как и у отдельных животных: если больных больше, чем здоровых, больные умирают с вероятностью 50%
+                int sickDeaths = cohort.healthy < cohort.sick ? rng.binomial(cohort.sick, 50) : 0;
+
+                // Старение стада целиком и смерть от старости по тем же правилам,
+                // что и у отдельных животных в checkAnimalAgingAndDeath
+                cohort.prototype.age++;
+                int deathChance = Animal::oldAgeDeathChance(cohort.prototype.age, cohort.prototype.genome);
+                int healthyDeaths = rng.binomial(cohort.healthy, deathChance);
+                sickDeaths += rng.binomial(cohort.sick - sickDeaths, deathChance);
+                diedTotal += healthyDeaths + sickDeaths;
+                changeCohort(enclosure, c, -healthyDeaths, -sickDeaths);
+            }
+            stateDigest.replace(before, StateDigest::enclosure(enclosure));
+        }
+
+        if (infectedTotal > 0) out() << L"В стадах заболело животных: " << infectedTotal << endl;
+        if (diedTotal > 0) out() << L"В стадах умерло животных: " << diedTotal << endl;
+    }
+
+    // Метод получения количества больных животных
+    int getCountSickAnimal() const {
+        return (int)zooIndex->byState[(int)AnimalState::SICK].size() + herdSick;
+    }
+
+    // Метод получения общего количества животных
+    int getCountAnimal() const {
+        return zooIndex->livingCount() + herdLiving;
+    }
+
+    // Метод получения количества животных в состоянии state, включая стада
+    // (умершие животные из стад сразу убираются, поэтому в DEAD их нет)
+    int getCountAnimal(AnimalState state) const {
+        int herd = state == AnimalState::HEALTHY ? herdLiving - herdSick : state == AnimalState::SICK ? herdSick : 0;
+        return (int)zooIndex->byState[(int)state].size() + herd;
+    }
+
+    // Метод получения хэша состояния зоопарка. Инкрементально (stateDigest) поддерживаются
+    // только животные и вольеры - их на порядки больше остального. Деньги, еда, популярность,
+    // заказы еды и персонал хэшируются заново при каждом вызове: O(заказов + сотрудников).
+    uint64_t digest() const {
+        return digestWith(stateDigest.value);
+    }
+
+    // Метод полного пересчета хэша состояния (для проверки инкрементального)
+    uint64_t recomputeDigest() const {
+        StateDigest full;
+        for (const Enclosure& enclosure : enclosures) {
+            full.toggle(StateDigest::enclosure(enclosure));
+            for (const AnimalVitals& animal : enclosure.animals.allVitals()) {
+                full.toggle(StateDigest::animal(enclosure.id, animal));
+            }
+        }
+        return digestWith(full.value);
+    }
+
+    // Метод публикации показателей дня, начавшегося в start (только атомарные записи)
+    void recordTick(chrono::steady_clock::time_point start) const {
+        if (metrics == nullptr) return;
+        metrics->tickLatency.record(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+        metrics->day.store(day, memory_order_relaxed);
+        metrics->money.store(money, memory_order_relaxed);
+        metrics->food[0].store(pantry.stock(Diet::PREDATORS), memory_order_relaxed);
+        metrics->food[1].store(pantry.stock(Diet::HERBIVORES), memory_order_relaxed);
+        metrics->popularity.store(popularity, memory_order_relaxed);
+        metrics->visitors.store(visitors, memory_order_relaxed);
+        for (int st = 0; st < 3; st++) {
+            metrics->animals[st].store(getCountAnimal((AnimalState)st), memory_order_relaxed);
+        }
+    }
+
+    // Метод объединения хэша животных и вольеров с остальным состоянием
+    uint64_t digestWith(uint64_t entities) const {
+        uint64_t hash = StateDigest::combine(entities, (uint32_t)day);
+        hash = StateDigest::combine(hash, ((uint64_t)(uint32_t)money << 32) | (uint32_t)popularity);
+        hash = StateDigest::combine(hash, ((uint64_t)(uint32_t)pantry.stock(Diet::PREDATORS) << 32) |
+            (uint32_t)pantry.stock(Diet::HERBIVORES));
+        uint64_t orders = 0; // Порядок обхода unordered_map не важен для XOR
+        for (const auto& order : foodOrders) {
+            orders ^= StateDigest::combine((uint32_t)order.first, ((uint64_t)order.second.diet << 32) | (uint32_t)order.second.amount);
+        }
+        hash = StateDigest::combine(hash, orders);
+        for (const Employee& worker : workers) {
+            hash = StateDigest::combine(hash, ((uint64_t)(uint32_t)worker.price << 32) | ((uint32_t)worker.efficiency << 8) |
+                ((uint32_t)worker.role << 1) | (worker.tired ? 1u : 0u));
+        }
+        return hash;
+    }
+
+    // Метод лечения животных по команде игрока: ветеринары делают сегодняшний обход сразу,
+    // по тем же правилам и с той же вместимостью, что и в runWorkforce. Поработавшие
+    // ветеринары устают и до отдыха больше не лечат, в том числе в конце дня.
+    void healthingAnimal() {
+        if (getCountSickAnimal() == 0) {
+            wcout << L"Нет больных животных.\n";
+            return;
+        }
+
+        vector<int> vets;
+        for (size_t i = 0; i < workers.size(); i++) {
+            if (workers[i].role == WorkerRole::VETERINAR && !workers[i].tired) vets.push_back((int)i);
+        }
+        if (vets.empty()) {
+            wcout << L"Нет свободных ветеринаров.\n";
+            return;
+        }
+
+        vector<int> worked;
+        int healed = treatSick(vets, &worked, true);
+        for (int worker : worked) {
+            workers[worker].tired = true;
+        }
+        wcout << L"Вылечено животных: " << healed << endl;
+        if (getCountSickAnimal() == 0) {
+            wcout << L"Все животные здоровы!\n";
+        }
+        else {
+            wcout << L"Еще остались больные животные\n";
+        }
+    }
+
+    // Метод перехода на следующий день
+    void nextDay() {
+        beginDay();
+
+        // Выполнение событий, запланированных на сегодня (отдых и зарплата сотрудников, обновление магазина)
+        dailyExpenses = 0;
+        vector<ZooEvent> dueEvents = scheduler.advance();
+        for (const ZooEvent& event : dueEvents) {
+            processEvent(event);
+        }
+        payEnclosureUpkeep();
+        int cost = dailyExpenses;
+        out() << L"Расходы: " << cost << endl;
+
+        // Подсчет животных
+        int totalAnimal = getCountAnimal();
+        int totalSickAnimal = getCountSickAnimal();
+
+        // Кормление животных: сначала списывается испорченная еда
+        int spoiled = pantry.expire(day);
+        if (spoiled > 0) {
+            out() << L"Испортилось еды: " << spoiled << endl;
+        }
+        int animals2feed = totalAnimal * FOOD_PER_ANIMAL;
+        int served = feedEnclosures();
+        out() << L"Кормление животных: " << served << endl;
+        if (served < animals2feed) {
+            out() << L"Не хватает еды для животных!" << endl;
+        }
+
+        // Обновление состояния вольеров (заболевшие переносятся в индекс)
+        vector<int> infected;
+        for (auto& enclosure : enclosures) {
+            uint64_t before = StateDigest::enclosure(enclosure);
+            size_t first = infected.size();
+            enclosure.update(&infected);
+            stateDigest.replace(before, StateDigest::enclosure(enclosure));
+            for (size_t i = first; i < infected.size(); i++) {
+                AnimalVitals sick = as_const(enclosure.animals).vitals(enclosure.findAnimal(infected[i]));
+                AnimalVitals healthy = sick;
+                healthy.state = AnimalState::HEALTHY;
+                stateDigest.replace(StateDigest::animal(enclosure.id, healthy), StateDigest::animal(enclosure.id, sick));
+            }
+        }
+        for (int id : infected) {
+            writeIndex().changeState(id, AnimalState::HEALTHY, AnimalState::SICK);
+        }
+        updateHerds();
+
+        // Работа персонала (уборка вольеров, у которых наступил срок, лечение, уход)
+        runWorkforce(dueEvents);
+        int dirtyZoo = 0;
+        for (const Enclosure& enclosure : as_const(enclosures)) {
+            dirtyZoo += enclosure.dirty;
+        }
+        out() << L"Загрязнение зоопарка: " << dirtyZoo << endl;
+
+        // Смерть от болезни
+        int* enclosureAnimal = new int;
+        int* sickAnimal = new int;
+        for (size_t e = 0; e < enclosures.size(); e++) {
+            const Enclosure& enclosure = as_const(enclosures)[e];
+            *enclosureAnimal = 0;
+            *sickAnimal = 0;
+            for (const AnimalVitals& animal : enclosure.animals.allVitals()) {
+                *enclosureAnimal += (animal.state != AnimalState::DEAD) ? 1 : 0;
+                *sickAnimal += (animal.state == AnimalState::SICK) ? 1 : 0;
+            }
+
+            // Если больных больше половины, животные умирают с вероятностью 50%
+            if ((*enclosureAnimal - *sickAnimal) < *sickAnimal) {
+                for (size_t i = 0; i < enclosure.animals.size(); i++) {
+                    AnimalVitals animal = enclosure.animals.vitals(i);
+                    if (animal.state == AnimalState::SICK && rng.range(2) == 0) {
+                        out() << L"ID: " << animal.id << L" | Имя: " << enclosure.animals.record(i).name << L" умерло.\n";
+                        setAnimalState(enclosures[e], i, AnimalState::DEAD);
+                    }
+                }
+            }
+        }
+        delete enclosureAnimal;
+        delete sickAnimal;
+
+        // Старение животных и смерть от старости (порог зависит от гена долголетия)
+        checkAnimalAgingAndDeath();
+
+        // Расчет посетителей и дохода
+        visitors = 2 * popularity;
+        settleEnclosures();
+        out() << L"Прибыль = " << ledger.net(day, day) << endl;
+
+        // Обновление популярности
+        popularity += rng.range(21) - 10; // Случайное изменение -10..+10
+        popularity -= totalSickAnimal;    // Уменьшение из-за больных животных
+        popularity = max(10, min(100, popularity)); // Ограничение 10..100
+
+        checkGameEnd();
+    }
+
+    // Метод проверки условий победы/поражения
+    void checkGameEnd() {
+        if (money < 0) {
+            if (sandbox) {
+                bankrupt = true;
+                return;
+            }
+            out() << L"\n!!! ВЫ БАНКРОТ !!!\n";
+            out() << L"Игра окончена. Вы продержались " << day << L" дней.\n";
+            exit(0);
+        }
+
+        if (!sandbox && day >= 30) {
+            out() << L"\n=== ПОБЕДА! ===\n";
+            out() << L"Вы успешно управляли зоопарком 30 дней!\n";
+            exit(0);
+        }
+    }
+
+    // Метод начисления дохода от посетителей и штрафа за грязь по каждому вольеру
+    // Посетители ходят по вольерам с учетом привлекательности вида и счастья животных.
+    // Средняя выручка равна прежней формуле "посетители * животные" с поправкой на счастье.
+    // Численность и счастье берутся из счетчиков вольера, поэтому расчет идет за O(вольеров).
+    void settleEnclosures() {
+        size_t count = enclosures.size();
+        vector<double> weights(count, 0.0);
+        vector<float> quality(count, 0.0f);
+        int totalAnimal = 0;
+        for (size_t e = 0; e < count; e++) {
+            const Enclosure& enclosure = as_const(enclosures)[e];
+            int living = enclosure.living();
+            if (living == 0) continue;
+            quality[e] = 0.5f + (float)((double)enclosure.happinessSum / living) / 200.0f;
+            weights[e] = typeAppeal(enclosure.animalType) * living * quality[e];
+            totalAnimal += living;
+        }
+
+        vector<float> spendPerStop(count);
+        for (size_t e = 0; e < count; e++) {
+            spendPerStop[e] = quality[e] * totalAnimal / VISITOR_STOPS;
+        }
+        vector<double> revenue;
+        visitorFlow.prepare(weights);
+        visitorFlow.simulate(visitors, rng.next(), spendPerStop, revenue);
+
+        for (size_t e = 0; e < count; e++) {
+            const Enclosure& enclosure = as_const(enclosures)[e];
+            earn(LedgerCategory::TICKETS, (int)lround(revenue[e]), enclosure.id);
+            spend(LedgerCategory::DIRT_PENALTY, enclosure.dirty * 2, enclosure.id);
+        }
+    }
+
+    // Привлекательность типа животных для посетителей
+    static double typeAppeal(const wstring& type) {
+        if (type == L"Кошачьи") return 1.5;
+        if (type == L"Морские") return 1.4;
+        if (type == L"Псовые") return 1.1;
+        if (type == L"Пресмыкающиеся") return 0.9;
+        return 1.0;
+    }
+
+    // Метод начала нового дня: счетчики дней и бездействия игрока
+    void beginDay() {
+        day++;
+        daysSurvived++;
+        if (animalShop.daysUntilRefresh > 0) animalShop.daysUntilRefresh--;
+        daysWithoutAction = hasPlayerTakenAction ? 0 : daysWithoutAction + 1;
+        hasPlayerTakenAction = false;
+        animalsBoughtToday = 0;
+    }
+
+    // Метод проверки, что день пройдет "тихо": никто не болеет и еды хватает.
+    // В тихий день экономика детерминирована, случайна только популярность.
+    // Стада стареют и вымирают по выборкам каждый день, поэтому с ними дни не тихие.
+    bool isQuietDay() const {
+        return herdLiving == 0 && getCountSickAnimal() == 0 && hasFoodFor(day + 1);
+    }
+
+    // Метод быстрого прохождения тихого дня без вывода и без проверок болезней
+    // (здоровье животных в тихий день не меняется, численность - только от старости)
+    void quietDay() {
+        beginDay();
+
+        dailyExpenses = 0;
+        vector<ZooEvent> dueEvents = scheduler.advance();
+        for (const ZooEvent& event : dueEvents) {
+            processEvent(event);
+        }
+        payEnclosureUpkeep();
+
+        pantry.expire(day);
+        int demand[2];
+        foodDemand(demand);
+        pantry.consume(Diet::PREDATORS, demand[0]);
+        pantry.consume(Diet::HERBIVORES, demand[1]);
+
+        // Без больных животных обновление вольера сводится к росту загрязнения
+        for (auto& enclosure : enclosures) {
+            uint64_t before = StateDigest::enclosure(enclosure);
+            enclosure.dirty += DIRT_PER_DAY;
+            stateDigest.replace(before, StateDigest::enclosure(enclosure));
+        }
+        runWorkforce(dueEvents, false);
+        int dirtyZoo = 0;
+        for (const Enclosure& enclosure : as_const(enclosures)) {
+            dirtyZoo += enclosure.dirty;
+        }
+        checkAnimalAgingAndDeath(false);
+
+        visitors = 2 * popularity;
+        settleEnclosures();
+
+        popularity += rng.range(21) - 10;
+        popularity = max(10, min(100, popularity));
+
+        checkGameEnd();
+    }
+
+    // Структура FastForward - состояние перемотки между днями
+    struct FastForward {
+        int days = 0;         // Сколько дней перемотать
+        int done = 0;         // Сколько уже прошло
+        int quietDays = 0;    // Из них тихих
+        int startMoney = 0;   // Деньги до перемотки
+        bool quiet = false;   // Текущий день тихий
+    };
+
+    // Метод начала перемотки времени на несколько дней
+    FastForward beginFastForward(int days) {
+        FastForward state;
+        state.days = days;
+        state.startMoney = money;
+        state.quiet = isQuietDay();
+        return state;
     }
 
-    // Метод получения количества больных животных
-    int getCountSickAnimal() const {
-        int totalSickAnimal = 0;
-        for (const auto& enclosure : enclosures) {
-            for (const auto& animal : enclosure.animals) {
-                totalSickAnimal += (animal.state == AnimalState::SICK) ? 1 : 0;
-            }
+    // Метод перемотки одного дня, возвращает false, когда перемотка закончена.
+    // Тихие отрезки проходятся быстрым путем, остальные дни - обычным nextDay.
+    bool fastForwardStep(FastForward& state) {
+        if (state.done >= state.days) return false;
+
+        auto start = chrono::steady_clock::now();
+        state.done++;
+        if (state.quiet && hasFoodFor(day + 1)) {
+            quietDay();
+            state.quietDays++;
+            recordTick(start);
+            return state.done < state.days;
         }
-        return totalSickAnimal;
+
+        // Обычный день может изменить численность и здоровье животных
+        nextDay();
+        recordTick(start);
+        state.quiet = isQuietDay();
+        return state.done < state.days;
     }
 
-    // Метод получения общего количества животных
-    int getCountAnimal() const {
-        int totalAnimal = 0;
-        for (const auto& enclosure : enclosures) {
-            for (const auto& animal : enclosure.animals) {
-                totalAnimal += (animal.state != AnimalState::DEAD) ? 1 : 0;
-            }
-        }
-        return totalAnimal;
+    // Метод вывода итога перемотки
+    void endFastForward(const FastForward& state) {
+        out() << L"\nПрошло дней: " << state.done << L" (из них тихих: " << state.quietDays << L")\n";
+        out() << L"Изменение денег: " << money - state.startMoney << endl;
     }
 
-    // Метод лечения животных
-    void healthingAnimal() {
-        int totalSickAnimal = getCountSickAnimal();
+    // Метод перемотки времени на несколько дней
+    void fastForward(int days) {
+        FastForward state = beginFastForward(days);
+        while (fastForwardStep(state)) {}
+        endFastForward(state);
+    }
 
-        if (totalSickAnimal == 0) {
-            wcout << L"Нет больных животных.\n";
-            return;
-        }
+    // Метод перемотки в фоне: дни идут, пока главное меню ждет ввода
+    void fastForwardAsync(int days) {
+        auto state = make_shared<FastForward>(beginFastForward(days));
+        EventLoop::instance().spawn({
+            [this, state]() { return fastForwardStep(*state); },
+            [state]() { return L"Перемотка: " + to_wstring(state->done) + L"/" + to_wstring(state->days) + L" дней"; },
+            [this, state]() { endFastForward(*state); } });
+    }
 
-        // Лечение животных ветеринарами
-        for (auto& worker : workers) {
-            if (worker.role == WorkerRole::VETERINAR && !worker.tired) {
-                if (totalSickAnimal >= 20) worker.tired = true;
-                int health = 0;
-                wcout << L"Ветеринар " << worker.name.c_str() << L", начал лечить животных:\n";
-                for (auto& animal : animals) {
-                    if (animal.state == AnimalState::SICK) {
-                        health++;
-                        animal.state = AnimalState::HEALTHY;
-                        wcout << L"ID: " << animal.id << L" | Имя: " << animal.name.c_str() << L" вылечили.\n";
-                    }
-                    if (health >= 20) break;
-                }
-                totalSickAnimal = getCountSickAnimal();
-                if (totalSickAnimal == 0) {
-                    wcout << L"Все животные здоровы!\n";
-                    return;
-                }
+    // Метод завершения фоновых задач перед действиями, которые сами двигают время
+    void finishBackgroundTasks() {
+        if (EventLoop::instance().taskCount() == 0) return;
+        wcout << L"Завершение фоновой перемотки...\n";
+        EventLoop::instance().runToCompletion();
+    }
+
+    // Метод режима реального времени: фоновый поток проводит дни с заданной скоростью,
+    // интерфейс читает опубликованные снимки и передает команды через очередь.
+    // Пока режим работает, зоопарк изменяет только поток симуляции.
+    void realTimeMode(ScreenRenderer& screen) {
+        int dayMs = getIntInput(L"Длительность дня в миллисекундах (0 - " + to_wstring(REALTIME_DAY_MS) + L"): ");
+        if (dayMs <= 0) dayMs = REALTIME_DAY_MS;
+
+        SpscQueue<PlayerCommand, COMMAND_QUEUE_SIZE> commands;
+        SnapshotBuffer<ZooSnapshot> snapshots;
+        bool wasSilent = silent;
+        bool wasSandbox = sandbox;
+        bool wasBankrupt = bankrupt;
+        silent = true;
+        sandbox = true; // Конец игры проверяется после выхода из режима, в основном потоке
+
+        captureSnapshot(snapshots.back(), {}, dayMs, false, false);
+        snapshots.publish();
+        thread simulation([&]() { runRealTime(commands, snapshots, dayMs, wasSandbox); });
+
+        while (true) {
+            const ZooSnapshot& view = snapshots.read();
+            screen.present(view.status);
+            wostringstream buffer;
+            buffer << L"\n=== Реальное время: " << view.dayMs << L" мс/день" << (view.paused ? L", пауза" : L"") << L" ===\n";
+            for (const wstring& line : view.log) buffer << L"  " << line << L'\n';
+            if (view.finished) {
+                buffer << L"Игра окончена, режим реального времени остановлен.\n";
+                wcout << buffer.str();
+                break;
+            }
+            buffer << L"Магазин:\n";
+            for (const wstring& line : view.shop) buffer << L"  " << line << L'\n';
+            buffer << L"0. Обновить экран\n1. Купить животное\n2. Купить еду\n3. Заказать еду оптом\n"
+                << L"4. Нанять сотрудника\n5. Построить вольер\n6. Размножение по плану\n"
+                << L"7. Пауза/продолжить\n8. Изменить скорость\n9. Выйти из режима\n";
+            wcout << buffer.str();
+
+            int choice = getIntInput(L"Выберите действие: ");
+            PlayerCommand command;
+            switch (choice) {
+            case 0: continue;
+            case 1:
+                command = { PlayerCommandType::BUY_ANIMAL, getIntInput(L"Номер животного в магазине: ") };
+                break;
+            case 2:
+            case 3:
+                command.type = choice == 2 ? PlayerCommandType::BUY_FOOD : PlayerCommandType::ORDER_FOOD;
+                command.first = getIntInput(L"Тип еды (1 - мясо, 2 - растительный корм): ") == 1 ? 0 : 1;
+                command.second = getIntInput(L"Количество: ");
+                break;
+            case 4:
+                command = { PlayerCommandType::HIRE, getIntInput(L"Должность (1 - ветеринар, 2 - уборщик, 3 - смотритель): ") };
+                break;
+            case 5:
+                command = { PlayerCommandType::BUILD, getIntInput(L"Климат (1 - континент, 2 - тропики, 3 - арктика): ") - 1 };
+                break;
+            case 6:
+                command.type = PlayerCommandType::BREED;
+                break;
+            case 7:
+                command.type = PlayerCommandType::PAUSE;
+                break;
+            case 8:
+                command = { PlayerCommandType::SPEED, getIntInput(L"Длительность дня в миллисекундах: ") };
+                break;
+            case 9:
+                command.type = PlayerCommandType::STOP;
+                break;
+            default:
+                wcout << L"Некорректный ввод.\n";
+                continue;
+            }
+            if (command.type == PlayerCommandType::STOP) break;
+            if (!commands.push(command)) {
+                wcout << L"Очередь команд заполнена, попробуйте позже.\n";
             }
         }
 
-        if (totalSickAnimal) {
-            wcout << L"Еще остались больные животные\n";
+        // Остановка потока (очередь может быть временно заполнена)
+        while (!commands.push({ PlayerCommandType::STOP })) {
+            this_thread::sleep_for(chrono::milliseconds(1));
         }
+        simulation.join();
+        silent = wasSilent;
+        sandbox = wasSandbox;
+        if (!sandbox) bankrupt = wasBankrupt;
+        checkGameEnd();
     }
 
-    // Метод перехода на следующий день
-    void nextDay() {
-        day++;
-        daysSurvived++;
-
-        // Обновление состояния сотрудников
-        for (auto& worker : workers) {
-            worker.update();
-        }
+    // Цикл потока симуляции: команды из очереди, дни по таймеру, публикация снимков
+    void runRealTime(SpscQueue<PlayerCommand, COMMAND_QUEUE_SIZE>& commands, SnapshotBuffer<ZooSnapshot>& snapshots,
+        int dayMs, bool rulesSandbox) {
+        deque<wstring> log;
+        bool paused = false;
+        bool finished = false;
+        auto nextTick = chrono::steady_clock::now() + chrono::milliseconds(dayMs);
 
-        // Расчет ежедневных расходов
-        int cost = 0;
-        for (Employee& worker : workers) { cost += worker.price; }
-        money -= cost;
-        wcout << L"Расходы: " << cost << endl;
+        while (true) {
+            bool changed = false;
+            PlayerCommand command;
+            while (commands.pop(command)) {
+                if (command.type == PlayerCommandType::STOP) return;
+                if (command.type == PlayerCommandType::PAUSE) {
+                    paused = !paused;
+                    nextTick = chrono::steady_clock::now() + chrono::milliseconds(dayMs);
+                }
+                else if (command.type == PlayerCommandType::SPEED) {
+                    dayMs = max(1, command.first);
+                    nextTick = chrono::steady_clock::now() + chrono::milliseconds(dayMs);
+                }
+                else if (!finished) {
+                    log.push_back(applyCommand(command));
+                }
+                changed = true;
+            }
 
-        // Подсчет животных
-        int totalAnimal = getCountAnimal();
-        int totalSickAnimal = getCountSickAnimal();
+            auto now = chrono::steady_clock::now();
+            if (!paused && !finished && now >= nextTick) {
+                nextDay();
+                recordTick(now);
+                log.push_back(L"День " + to_wstring(day) + L": деньги " + to_wstring(money) + L", животных " + to_wstring(getCountAnimal()));
+                finished = bankrupt || (!rulesSandbox && day >= 30);
+                // Если день считается дольше заданного, следующий начинается сразу, без наверстывания
+                nextTick = max(nextTick + chrono::milliseconds(dayMs), chrono::steady_clock::now());
+                changed = true;
+            }
 
-        // Кормление животных
-        int animals2feed = totalAnimal * 2;
-        if (food >= animals2feed) {
-            food -= animals2feed;
-            wcout << L"Кормление животных: " << animals2feed << endl;
-        }
-        else {
-            // Животные умирают от голода с вероятностью 10%
-            for (auto& animal : animals) {
-                if (rand() % 10 == 0) {
-                    animal.state = AnimalState::DEAD;
-                }
+            if (changed) {
+                while ((int)log.size() > REALTIME_LOG_SIZE) log.pop_front();
+                captureSnapshot(snapshots.back(), log, dayMs, paused, finished);
+                snapshots.publish();
             }
-            wcout << L"Не хватает еды для животных!" << endl;
+            this_thread::sleep_for(chrono::milliseconds(min(10, dayMs)));
         }
+    }
 
-        // Обновление состояния вольеров
-        for (auto& enclosure : enclosures) {
-            enclosure.update();
+    // Метод выполнения команды игрока в потоке симуляции, возвращает сообщение о результате
+    wstring applyCommand(const PlayerCommand& command) {
+        switch (command.type) {
+        case PlayerCommandType::BUY_ANIMAL:
+            return buyAnimal(command.first) ? L"Животное куплено." : L"Не удалось купить животное.";
+        case PlayerCommandType::BUY_FOOD:
+            if (command.second <= 0 || money < command.second * 10) return L"Недостаточно денег для покупки еды.";
+            buyFood((Diet)command.first, command.second);
+            return L"Куплено еды: " + to_wstring(command.second);
+        case PlayerCommandType::ORDER_FOOD:
+            return orderFood((Diet)command.first, command.second) ? L"Заказ еды оформлен." : L"Заказ еды не оформлен.";
+        case PlayerCommandType::HIRE: {
+            static const WorkerRole roles[] = { WorkerRole::VETERINAR, WorkerRole::CLEANER, WorkerRole::FOODMEN };
+            if (command.first < 1 || command.first > 3 || workers.size() >= MAX_EMPLOYEES) return L"Нанять сотрудника нельзя.";
+            return hireWorker(roles[command.first - 1]) ? L"Сотрудник нанят." : L"Недостаточно денег для найма.";
         }
-
-        // Уборка вольеров
-        int cleanerCount = 0;
-        int dirtyZoo = 0;
-        for (Employee& worker : workers) {
-            if (worker.role == WorkerRole::CLEANER) cleanerCount++;
+        case PlayerCommandType::BUILD:
+            if (command.first < 0 || command.first > 2) return L"Некорректный климат.";
+            return buildEnclosure((Climate)command.first) ? L"Вольер построен." : L"Недостаточно денег для строительства.";
+        case PlayerCommandType::BREED: {
+            if (lastBreedingDay == day) return L"Сегодня размножение по плану уже проводилось.";
+            vector<BreedingPair> plan = planBreeding(BREEDING_BATCH_SIZE);
+            if (plan.empty()) return L"Подходящих пар не найдено.";
+            return L"Родилось детенышей: " + to_wstring(breedPlanned(plan));
         }
-        for (Enclosure& enclosure : enclosures) {
-            if (enclosure.needsCleaning() && cleanerCount > 0) {
-                enclosure.clean();
-                cleanerCount--;
-            }
-            dirtyZoo += enclosure.dirty;
+        default:
+            return L"";
         }
-        wcout << L"Загрязнение зоопарка: " << dirtyZoo << endl;
+    }
 
-        // Обновление состояния животных
-        for (auto& animal : animals) {
-            animal.update();
+    // Метод заполнения снимка для интерфейса (вызывается потоком, который изменяет зоопарк)
+    void captureSnapshot(ZooSnapshot& snapshot, const deque<wstring>& log, int dayMs, bool paused, bool finished) {
+        snapshot.status = statusLines();
+        snapshot.shop.clear();
+        for (size_t i = 0; i < animalShop.size() && i < (size_t)LIST_PAGE_SIZE; i++) {
+            const Animal& animal = animalShop.get(i);
+            snapshot.shop.push_back(to_wstring(i) + L". " + animal.displayName() + L" (" + animal.specificType() + L", "
+                + climateName(animal.climate) + L") - " + to_wstring(animal.price));
         }
+        snapshot.log = log;
+        snapshot.dayMs = dayMs;
+        snapshot.paused = paused;
+        snapshot.finished = finished;
+    }
 
-        // Смерть от болезни
-        int* enclosureAnimal = new int;
-        int* sickAnimal = new int;
-        for (auto& enclosure : enclosures) {
-            *enclosureAnimal = 0;
-            *sickAnimal = 0;
-            for (const auto& animal : enclosure.animals) {
-                *enclosureAnimal += (animal.state != AnimalState::DEAD) ? 1 : 0;
-                *sickAnimal += (animal.state == AnimalState::SICK) ? 1 : 0;
-            }
+    // Метод создания ветки "что если": копия зоопарка, которая разделяет с оригиналом
+    // вольеры и животных и копирует только то, что изменит сама
+    Zoo fork(uint32_t seed) const {
+        Zoo branch = *this;
+        branch.rng = GameRandom(seed);
+        branch.metrics = nullptr;
+        branch.silent = true;
+        branch.sandbox = true;
+        return branch;
+    }
 
-            // Если больных больше половины, животные умирают с вероятностью 50%
-            if ((*enclosureAnimal - *sickAnimal) < *sickAnimal) {
-                for (auto& animal : enclosure.animals) {
-                    if (animal.state == AnimalState::SICK && rand() % 2 == 0) {
-                        wcout << L"ID: " << animal.id << L" | Имя: " << animal.name.c_str() << L" умерло.\n";
-                        animal.state = AnimalState::DEAD;
-                    }
+    // Метод прогноза: сравнение нескольких вариантов будущего на ветках fork.
+    // Все варианты используют одни и те же зерна, поэтому различия вызваны только решением игрока.
+    void forecast() {
+        int days = getIntInput(L"На сколько дней вперед сделать прогноз? ");
+        if (days <= 0) return;
+
+        const int branchesPerScenario = 20;
+        const wchar_t* scenarios[] = { L"Ничего не менять", L"Нанять ветеринара", L"Нанять уборщика", L"Построить вольер" };
+        uint32_t baseSeed = rng.next();
+
+        wcout << L"\n=== Прогноз на " << days << L" дней (" << branchesPerScenario << L" вариантов каждого решения) ===\n";
+        for (int scenario = 0; scenario < 4; scenario++) {
+            long long totalMoney = 0;
+            int bankrupts = 0;
+            for (int i = 0; i < branchesPerScenario; i++) {
+                Zoo branch = fork(GameRandom::mix(baseSeed, i));
+                switch (scenario) {
+                case 1: branch.hireWorker(WorkerRole::VETERINAR); break;
+                case 2: branch.hireWorker(WorkerRole::CLEANER); break;
+                case 3: branch.buildEnclosure(Climate::CONTINENT); break;
                 }
+                branch.fastForward(days);
+                totalMoney += branch.money;
+                bankrupts += branch.bankrupt ? 1 : 0;
             }
+            wcout << scenarios[scenario] << L": в среднем " << totalMoney / branchesPerScenario << L" денег";
+            if (bankrupts > 0) {
+                wcout << L", банкротство в " << bankrupts << L" из " << branchesPerScenario;
+            }
+            wcout << endl;
         }
-        delete enclosureAnimal;
-        delete sickAnimal;
-
-        // Расчет посетителей и дохода
-        visitors = 2 * popularity;
-        wcout << L"Прибыль = " << visitors * totalAnimal - (dirtyZoo * 2) - cost << endl;
-        money += visitors * totalAnimal - (dirtyZoo * 2);
+    }
 
-        // Обновление популярности
-        popularity += (rand() % 21 - 10); // Случайное изменение -10..+10
-        popularity -= totalSickAnimal;    // Уменьшение из-за больных животных
-        popularity = max(10, min(100, popularity)); // Ограничение 10..100
+    // Метод поиска вольера, куда можно поместить животное
+    // (те же правила, что и при покупке через меню, климат - по возможности тот же)
+    Enclosure* findEnclosureFor(const Animal& animal) {
+        int position = PlacementEngine(as_const(enclosures)).place(animal);
+        return position < 0 ? nullptr : &enclosures[position];
+    }
 
-        // Проверка условий победы/поражения
-        if (money < 0) {
-            wcout << L"\n!!! ВЫ БАНКРОТ !!!\n";
-            wcout << L"Игра окончена. Вы продержались " << day << L" дней.\n";
-            exit(0);
+    // Метод проверки, подходит ли вольер для count животных, похожих на animal: тип, хищники,
+    // вид и место. Климат, как и в PlacementEngine, должен совпадать, пока есть подходящий
+    // вольер с климатом животного; иначе допускается любой.
+    bool enclosureSuits(const Enclosure& enclosure, const Animal& animal, int count, bool anyClimate) const {
+        if (enclosure.animalType != animal.type() || enclosure.isPredatorEnclosure != (bool)animal.isPredator ||
+            (!enclosure.specificAnimalType.empty() && enclosure.specificAnimalType != animal.specificType())) {
+            return false;
         }
+        if (enclosure.occupancy() + count > enclosure.capacity) return false;
+        if (anyClimate || enclosure.climate == animal.climate) return true;
+        for (const Enclosure& other : enclosures) {
+            if (other.climate == animal.climate && enclosureSuits(other, animal, count, true)) return false;
+        }
+        return true;
+    }
 
-        if (day >= 30) {
-            wcout << L"\n=== ПОБЕДА! ===\n";
-            wcout << L"Вы успешно управляли зоопарком 30 дней!\n";
-            exit(0);
+    // Метод размещения партии животных: номер вольера для каждого (-1 - места нет)
+    vector<int> planPlacement(const vector<Animal>& batch, PlacementEngine& engine) const {
+        vector<int> placement;
+        placement.reserve(batch.size());
+        for (const Animal& animal : batch) {
+            placement.push_back(engine.place(animal));
         }
+        return placement;
     }
 
-    // Метод покупки животного
+    // Метод приема животного в зоопарк: назначает ID и помещает в первый подходящий вольер
+    // (подборщик engine построен по вольерам этого зоопарка и может служить серии приемов)
+    bool receiveAnimal(Animal animal, PlacementEngine& engine) {
+        int position = engine.place(animal);
+        if (position < 0) return false;
+
+        animal.id = nextAnimalId++;
+        placeAnimal(enclosures[position], animal);
+        animalsCount++;
+        return true;
+    }
+
+    // Метод покупки животного из магазина
     bool buyAnimal(int animalIndex) {
-        if (animalIndex < 0 || animalIndex >= animals.size()) return false;
+        return buyAnimals({ animalIndex }) == 1;
+    }
 
-        Animal animal = animals[animalIndex];
-        if (money < animal.price) return false;
+    // Метод покупки животного из магазина с размещением через общий подборщик
+    bool buyAnimal(int animalIndex, PlacementEngine& engine) {
+        return buyAnimals({ animalIndex }, engine) == 1;
+    }
 
-        // Попытка добавить животное в первый подходящий вольер
-        for (auto& enclosure : enclosures) {
-            if (enclosure.addAnimal(animal)) {
-                money -= animal.price;
-                return true;
+    // Метод покупки партии животных из магазина с автоматическим размещением,
+    // возвращает количество купленных животных
+    int buyAnimals(const vector<int>& shopIndexes) {
+        PlacementEngine engine(as_const(enclosures));
+        return buyAnimals(shopIndexes, engine);
+    }
+
+    // Метод покупки партии животных с размещением через подборщик engine
+    // (места, зарезервированные под не купленных животных, возвращаются ему)
+    int buyAnimals(const vector<int>& shopIndexes, PlacementEngine& engine) {
+        vector<int> positions;
+        vector<Animal> batch;
+        for (int shopIndex : shopIndexes) {
+            if (shopIndex < 0 || shopIndex >= (int)animalShop.size()) continue;
+            if (find(positions.begin(), positions.end(), shopIndex) != positions.end()) continue;
+            positions.push_back(shopIndex);
+            batch.push_back(animalShop.get(shopIndex));
+        }
+
+        vector<int> placement = planPlacement(batch, engine);
+        vector<int> bought;
+        vector<int> unused;
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (placement[i] < 0) continue;
+            if (money < batch[i].price) {
+                unused.push_back(placement[i]);
+                continue;
             }
+
+            spend(LedgerCategory::ANIMAL_PURCHASE, batch[i].price, as_const(enclosures)[placement[i]].id);
+            batch[i].id = nextAnimalId++;
+            placeAnimal(enclosures[placement[i]], batch[i]);
+            animalsCount++;
+            bought.push_back(positions[i]);
+        }
+        for (int position : unused) {
+            engine.release(position);
         }
 
-        return false;
+        // Купленные животные убираются из магазина с конца, чтобы не сдвигать номера
+        sort(bought.rbegin(), bought.rend());
+        for (int shopIndex : bought) {
+            animalShop.take(shopIndex);
+        }
+        return (int)bought.size();
     }
 
     // Метод найма сотрудника
@@ -510,126 +3680,126 @@ public:
         if (money < salary) return false;
 
         // Генерация случайного имени для сотрудника
-        string names[] = { "Иван", "Мария", "Петр", "Анна", "Сергей", "Костеннов" };
-        workers.emplace_back(names[rand() % 5], salary, role);
-        money -= salary;
+        // (имена добавляются в пул один раз)
+        static const NameHandle names[] = { NameHandle::of(L"Иван"), NameHandle::of(L"Мария"), NameHandle::of(L"Петр"),
+            NameHandle::of(L"Анна"), NameHandle::of(L"Сергей"), NameHandle::of(L"Костеннов") };
+        workers.emplace_back(names[rng.range(5)], salary, role);
+        workers.back().efficiency = role == WorkerRole::CLEANER ? 70 + rng.range(31) : 60 + rng.range(41);
+        spend(LedgerCategory::HIRING, salary);
         return true;
     }
 
     // Метод строительства вольера
-    bool buildEnclosure(Climate climate, int capacity = 5) {
-        int cost = capacity * 100;
+    bool buildEnclosure(Climate climate, EnclosureKind kind = EnclosureKind::REGULAR) {
+        int cost = enclosureBuildCost(kind);
         if (money < cost) return false;
 
-        enclosures.emplace_back(capacity, climate);
-        money -= cost;
+        Enclosure& built = addEnclosure(Enclosure::make(kind, climate));
+        spend(LedgerCategory::CONSTRUCTION, cost, built.id);
+        return true;
+    }
+
+    // Метод улучшения вольера до следующего уровня
+    bool upgradeEnclosure(Enclosure& enclosure) {
+        const EnclosureLevel& current = enclosure.economics();
+        if (current.upgradeCost == 0 || money < current.upgradeCost) return false;
+
+        spend(LedgerCategory::UPGRADE, current.upgradeCost, enclosure.id);
+        uint64_t before = StateDigest::enclosure(enclosure);
+        enclosure.upgradeLevel++;
+        const EnclosureLevel& next = enclosure.economics();
+        enclosure.capacity += next.capacity - current.capacity;
+        stateDigest.replace(before, StateDigest::enclosure(enclosure));
+        enclosure.dailyCost += next.dailyCost - current.dailyCost;
         return true;
     }
 
-    // Метод покупки еды
-    void buyFood(int amount) {
-        int cost = amount * 10;
-        if (money >= cost) {
-            food += amount;
-            money -= cost;
+    // Метод оплаты содержания всех вольеров за день. Каждый вольер платит отдельной
+    // записью, чтобы содержание попадало в отчет о прибыли вольеров.
+    void payEnclosureUpkeep() {
+        int upkeep = 0;
+        for (const Enclosure& enclosure : as_const(enclosures)) {
+            spend(LedgerCategory::UPKEEP, enclosure.dailyCost, enclosure.id);
+            upkeep += enclosure.dailyCost;
         }
+        dailyExpenses += upkeep;
+    }
+
+    // Метод покупки еды по BASE_FOOD_COST (поступает на склад сразу), false - не хватило денег
+    bool buyFood(Diet diet, int amount) {
+        int cost = amount * BASE_FOOD_COST;
+        if (money < cost) return false;
+        spend(LedgerCategory::FOOD, cost);
+        pantry.add(diet, amount, day + FOOD_SHELF_LIFE);
+        return true;
+    }
+
+    // Метод оптового заказа еды: дешевле, но доставка через FOOD_DELIVERY_DAYS дней
+    bool orderFood(Diet diet, int amount) {
+        int cost = amount * BASE_FOOD_COST * BULK_FOOD_PRICE_PERCENT / 100;
+        if (amount <= 0 || money < cost) return false;
+
+        spend(LedgerCategory::FOOD, cost);
+        int orderId = nextFoodOrderId++;
+        foodOrders[orderId] = { diet, amount };
+        scheduler.schedule({ ZooEventType::FOOD_DELIVERY, day + FOOD_DELIVERY_DAYS, 0, orderId });
+        return true;
     }
 
     // Метод заказа рекламы
     void advertise() {
         if (money >= 50) {
             popularity = min(100, popularity + 15);
-            money -= 50;
+            spend(LedgerCategory::ADVERTISING, 50);
         }
     }
 
     // Метод обновления магазина животных
     void refreshAnimalShop() {
-        animalShop.availableAnimals.clear();
-        int animalCount = min(10, 5 + (rand() % 6)); // 5-10 животных
-
-        for (int i = 0; i < animalCount; i++) {
-            Animal newAnimal;
-
-            // Выбор случайного типа животного
-            wstring types[] = { L"Кошачьи", L"Псовые", L"Птицы", L"Пресмыкающиеся", L"Морские" };
-            newAnimal.type = types[rand() % 5];
-
-            // Генерация характеристик в зависимости от типа
-            if (newAnimal.type == L"Кошачьи") {
-                wstring specificTypes[] = { L"Лев", L"Тигр", L"Леопард", L"Рысь", L"Гепард" };
-                newAnimal.specificType = specificTypes[rand() % 5];
-                wstring names[] = { L"Рыжик", L"Полосатик", L"Пятнышко", L"Грива", L"Коготь" };
-                newAnimal.wname = names[rand() % 5] + L" " + to_wstring(rand() % 1000);
-                newAnimal.isPredator = true;
-            }
-            else if (newAnimal.type == L"Псовые") {
-                wstring specificTypes[] = { L"Собака", L"Волк", L"Лиса", L"Шакал", L"Гиена" };
-                newAnimal.specificType = specificTypes[rand() % 5];
-                wstring names[] = { L"Бобик", L"Шарик", L"Рекс", L"Лорд", L"Тузик" };
-                newAnimal.wname = names[rand() % 5] + L" " + to_wstring(rand() % 1000);
-                newAnimal.isPredator = (newAnimal.specificType != L"Собака");
-            }
-            else if (newAnimal.type == L"Птицы") {
-                wstring specificTypes[] = { L"Орел", L"Попугай", L"Пингвин", L"Сова", L"Фламинго" };
-                newAnimal.specificType = specificTypes[rand() % 5];
-                wstring names[] = { L"Крыло", L"Клюв", L"Перо", L"Коготок", L"Пташка" };
-                newAnimal.wname = names[rand() % 5] + L" " + to_wstring(rand() % 1000);
-                newAnimal.isPredator = (newAnimal.specificType == L"Орел" || newAnimal.specificType == L"Сова" || newAnimal.specificType == L"Пингвин");
-            }
-            else if (newAnimal.type == L"Пресмыкающиеся") {
-                wstring specificTypes[] = { L"Змея", L"Черепаха", L"Ящерица", L"Крокодил", L"Динозавр" };
-                newAnimal.specificType = specificTypes[rand() % 5];
-                wstring names[] = { L"Шип", L"Чешуя", L"Змей", L"Клык", L"Хвост" };
-                newAnimal.wname = names[rand() % 5] + L" " + to_wstring(rand() % 1000);
-                newAnimal.isPredator = (newAnimal.specificType == L"Змея" || newAnimal.specificType == L"Крокодил" || newAnimal.specificType == L"Динозавр");
-            }
-            else if (newAnimal.type == L"Морские") {
-                wstring specificTypes[] = { L"Дельфин", L"Акула", L"Моллюски", L"Осьминог", L"Кит" };
-                newAnimal.specificType = specificTypes[rand() % 5];
-                wstring names[] = { L"Волна", L"Плавник", L"Пузырь", L"Ракушка", L"Жемчуг" };
-                newAnimal.wname = names[rand() % 5] + L" " + to_wstring(rand() % 1000);
-                newAnimal.isPredator = (newAnimal.specificType == L"Акула" || newAnimal.specificType == L"Осьминог" || newAnimal.specificType == L"Дельфин");
-            }
-
-            // Установка случайного климата
-            wstring climates[] = { L"Тропический", L"Умеренный", L"Арктический" };
-            newAnimal.climate = static_cast<Climate>(rand() % 3);
-
-            // Установка случайных характеристик
-            newAnimal.age = rand() % MAX_AGE + 1;
-            newAnimal.weight = rand() % 400 + 10;
-            newAnimal.isSick = false;
-            newAnimal.isHungry = false;
-            newAnimal.isUnhappy = false;
-            newAnimal.happiness = 70 + rand() % 31; // 70-100
-            newAnimal.gender = (rand() % 2 == 0) ? 'M' : 'F';
-            newAnimal.price = calculateAnimalPrice(newAnimal.age, newAnimal.weight);
-            newAnimal.bornInZoo = false;
-
-            animalShop.availableAnimals.push_back(newAnimal);
-        }
-
-        animalShop.daysUntilRefresh = 1 + (rand() % 3); // 1-3 дня до обновления
+        int animalCount = min(10, 5 + rng.range(6)); // 5-10 животных
+        animalShop.restock(rng.next(), animalCount);
+
+        animalShop.daysUntilRefresh = 1 + rng.range(3); // 1-3 дня до обновления
+        animalShop.generation++;
+        scheduler.schedule({ ZooEventType::SHOP_REFRESH, day + animalShop.daysUntilRefresh, 0, animalShop.generation });
     }
 
     // Метод отображения статуса зоопарка
     void displayStatus() {
-        wcout << L"\n=== Статус зоопарка ===\n";
-        wcout << L"Название: " << wname << endl;
-        wcout << L"Еда: " << food << endl;
-        wcout << L"Деньги: " << money << endl;
-        wcout << L"Популярность: " << popularity << L"/" << MAX_POPULARITY << endl;
-        wcout << L"Посетители: " << visitors << endl;
-        wcout << L"Животные: " << animalsCount << endl;
-        wcout << L"Вольеров: " << enclosures.size() << endl;
-        wcout << L"Количество сотрудников: " << workers.size() << L"/" << MAX_EMPLOYEES << endl;
-        wcout << L"Прожито дней: " << daysSurvived << endl;
-        wcout << L"До обновления магазина: " << animalShop.daysUntilRefresh << L" дней" << endl;
-        wcout << L"Делегация TOI-1452 b довольна? " << (delegationSatisfied ? L"Да" : L"Нет") << endl;
+        wostringstream buffer;
+        buffer << L'\n';
+        for (const wstring& line : statusLines()) buffer << line << L'\n';
+        wcout << buffer.str();
+    }
+
+    // Метод построения панели статуса (по строке на показатель)
+    vector<wstring> statusLines() const {
+        vector<wstring> lines;
+        wostringstream line;
+        auto emit = [&]() {
+            lines.push_back(line.str());
+            line.str(L"");
+        };
+
+        line << L"=== Статус зоопарка ==="; emit();
+        line << L"Название: " << name; emit();
+        line << L"Еда: " << foodName(Diet::PREDATORS) << L" " << pantry.stock(Diet::PREDATORS)
+            << L", " << foodName(Diet::HERBIVORES) << L" " << pantry.stock(Diet::HERBIVORES);
+        if (!foodOrders.empty()) line << L" (заказов в пути: " << foodOrders.size() << L")";
+        emit();
+        line << L"Деньги: " << money; emit();
+        line << L"Популярность: " << popularity << L"/" << MAX_POPULARITY; emit();
+        line << L"Посетители: " << visitors; emit();
+        line << L"Животные: " << animalsCount; emit();
+        line << L"Вольеров: " << enclosures.size(); emit();
+        line << L"Количество сотрудников: " << workers.size() << L"/" << MAX_EMPLOYEES; emit();
+        line << L"Прожито дней: " << daysSurvived; emit();
+        line << L"До обновления магазина: " << animalShop.daysUntilRefresh << L" дней"; emit();
+        line << L"Делегация TOI-1452 b довольна? " << (delegationSatisfied ? L"Да" : L"Нет"); emit();
         if (daysSurvived >= 10) {
-            wcout << L"Животных куплено сегодня: " << animalsBoughtToday << L"/1" << endl;
+            line << L"Животных куплено сегодня: " << animalsBoughtToday << L"/1"; emit();
         }
+        return lines;
     }
 
     // Метод получения целочисленного ввода с проверкой
@@ -637,17 +3807,8 @@ public:
         int value;
         while (true) {
             wcout << prompt;
-            wcin >> value;
-
-            if (wcin.fail()) {
-                wcout << L"Ошибка: Введите число.\n";
-                wcin.clear();
-                wcin.ignore(numeric_limits<streamsize>::max(), '\n');
-            }
-            else {
-                wcin.ignore(numeric_limits<streamsize>::max(), '\n');
-                return value;
-            }
+            if (EventLoop::instance().readInt(value)) return value;
+            wcout << L"Ошибка: Введите число.\n";
         }
     }
 
@@ -668,7 +3829,44 @@ public:
     // Метод генерации случайного имени
     wstring generateRandomName() {
         wstring names[] = { L"Анна", L"Борис", L"Виктория", L"Глеб", L"Дарья", L"Егор", L"Жанна", L"Ирина", L"Константин" };
-        return names[rand() % 9];
+        return names[rng.range(9)];
+    }
+
+    // Метод постраничного вывода списка. renderPage выводит записи [first, last) в буфер,
+    // на экран страница уходит одной записью. Если страниц несколько, игрок может листать.
+    void browsePages(size_t total, const function<void(wostringstream&, size_t, size_t)>& renderPage) {
+        size_t pages = (total + LIST_PAGE_SIZE - 1) / LIST_PAGE_SIZE;
+        size_t page = 0;
+        while (true) {
+            size_t first = page * LIST_PAGE_SIZE;
+            size_t last = min(total, first + LIST_PAGE_SIZE);
+
+            wostringstream buffer;
+            renderPage(buffer, first, last);
+            if (pages > 1) {
+                buffer << L"Страница " << page + 1 << L"/" << pages << L" (всего записей: " << total << L")\n";
+            }
+            wcout << buffer.str();
+
+            if (pages <= 1) return;
+            int next = getIntInput(L"Номер страницы (1-" + to_wstring(pages) + L") или 0 для продолжения: ");
+            if (next <= 0 || next > (int)pages) return;
+            page = next - 1;
+        }
+    }
+
+    // Метод вывода карточки животного в буфер
+    void renderAnimalCard(wostringstream& buffer, size_t number, const Animal& animal) {
+        buffer << number << L". " << animal.displayName() << L" (" << animal.specificType() << L")\n";
+        buffer << L"   Тип: " << animal.type() << L", Пол: " << animal.gender() << L'\n';
+        buffer << L"   Возраст: " << animal.age << L"д, Вес: " << animal.weight << L"кг\n";
+        buffer << L"   Климат: " << climateName(animal.climate) << L", Хищник: " << (animal.isPredator ? L"Да" : L"Нет") << L'\n';
+        buffer << L"   Здоровье: " << (animal.state == AnimalState::SICK ? L"Больное" : L"Здоровое") << L'\n';
+        buffer << L"   Сытость: " << (animal.isHungry ? L"Голодное" : L"Сытое") << L'\n';
+        buffer << L"   Счастье: " << animal.happiness << L"/100\n";
+        buffer << L"   Гены: вес " << animal.genome.trait(Genome::WEIGHT) << L", долголетие " << animal.genome.trait(Genome::LIFESPAN)
+            << L", устойчивость " << animal.genome.trait(Genome::RESISTANCE) << L", плодовитость " << animal.genome.trait(Genome::FERTILITY)
+            << L" (из " << Genome::GENE_BITS << L")\n";
     }
 
     // Метод отображения списка животных
@@ -679,22 +3877,135 @@ public:
             return;
         }
 
-        for (size_t i = 0; i < animals.size(); ++i) {
-            const auto& animal = animals[i];
-            wcout << i << L". " << animal.wname << L" (" << animal.specificType << L")" << endl;
-            wcout << L"   Тип: " << animal.type << L", Пол: " << animal.gender << endl;
-            wcout << L"   Возраст: " << animal.age << L"д, Вес: " << animal.weight << L"кг" << endl;
-            wcout << L"   Климат: ";
-            switch (animal.climate) {
-            case Climate::CONTINENT: wcout << L"Континент"; break;
-            case Climate::TROPIC: wcout << L"Тропики"; break;
-            case Climate::ARCTIC: wcout << L"Арктика"; break;
+        browsePages(animals.size(), [&](wostringstream& buffer, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                renderAnimalCard(buffer, i, animals[i]);
+            }
+            });
+    }
+
+    // Метод отбора животных по условиям запроса (с сортировкой).
+    // Больные и животные одного вида берутся из индексов, остальные фильтры - обходом вольеров.
+    // Животные стад не имеют отдельных записей и в выборку не попадают (они видны в меню стад).
+    vector<AnimalRef> queryAnimals(const AnimalQuery& query) const {
+        vector<AnimalRef> result;
+        const unordered_set<int>* candidates = nullptr;
+        if (query.enclosureIndex < 0 && !query.species.empty()) {
+            auto found = zooIndex->bySpecies.find(query.species);
+            if (found == zooIndex->bySpecies.end()) return result;
+            candidates = &found->second;
+        }
+        if (query.enclosureIndex < 0 && query.onlySick) {
+            const unordered_set<int>& sick = zooIndex->byState[(int)AnimalState::SICK];
+            if (candidates == nullptr || sick.size() < candidates->size()) candidates = &sick;
+        }
+
+        if (candidates != nullptr) {
+            for (int id : *candidates) {
+                size_t e = zooIndex->enclosurePosition.at(zooIndex->enclosureOf.at(id));
+                int i = enclosures[e].findAnimal(id);
+                if (query.matches(enclosures[e].animals[i])) {
+                    result.push_back({ (int)e, i });
+                }
+            }
+            // Порядок как при обходе вольеров, а не как в хэш-таблице индекса
+            sort(result.begin(), result.end(), [](const AnimalRef& a, const AnimalRef& b) {
+                return a.enclosureIndex != b.enclosureIndex ? a.enclosureIndex < b.enclosureIndex : a.animalIndex < b.animalIndex;
+            });
+        }
+        else {
+            size_t firstEnclosure = query.enclosureIndex >= 0 ? query.enclosureIndex : 0;
+            size_t lastEnclosure = query.enclosureIndex >= 0 ? min(enclosures.size(), (size_t)query.enclosureIndex + 1) : enclosures.size();
+            for (size_t e = firstEnclosure; e < lastEnclosure; ++e) {
+                const Enclosure& enclosure = enclosures[e];
+                for (size_t i = 0; i < enclosure.animals.size(); ++i) {
+                    if (query.matches(enclosure.animals[i])) {
+                        result.push_back({ (int)e, (int)i });
+                    }
+                }
+            }
+        }
+
+        auto vitalsAt = [this](const AnimalRef& ref) -> const AnimalVitals& {
+            return enclosures[ref.enclosureIndex].animals.vitals(ref.animalIndex);
+        };
+        if (query.sort == AnimalSort::NAME) {
+            // Имена читаются из пула один раз на животное, а не при каждом сравнении
+            vector<pair<wstring, AnimalRef>> named;
+            named.reserve(result.size());
+            for (const AnimalRef& ref : result) {
+                named.emplace_back(enclosures[ref.enclosureIndex].animals.record(ref.animalIndex).name.str(), ref);
+            }
+            stable_sort(named.begin(), named.end(), [](const pair<wstring, AnimalRef>& a, const pair<wstring, AnimalRef>& b) {
+                return a.first < b.first;
+                });
+            for (size_t i = 0; i < named.size(); i++) {
+                result[i] = named[i].second;
+            }
+        }
+        else if (query.sort != AnimalSort::NONE) {
+            stable_sort(result.begin(), result.end(), [&](const AnimalRef& a, const AnimalRef& b) {
+                const AnimalVitals& first = vitalsAt(a);
+                const AnimalVitals& second = vitalsAt(b);
+                switch (query.sort) {
+                case AnimalSort::AGE: return first.age < second.age;
+                case AnimalSort::PRICE: return first.price > second.price;
+                case AnimalSort::HAPPINESS: return first.happiness < second.happiness;
+                default: return false;
+                }
+                });
+        }
+        return result;
+    }
+
+    // Метод просмотра животных всего зоопарка с фильтрами, сортировкой и страницами
+    void browseAnimals() {
+        AnimalQuery query;
+        wcout << L"\nФильтр: 0. Все  1. Больные  2. Голодные  3. Несчастные  4. По виду  5. По вольеру\n";
+        switch (getIntInput(L"Ваш выбор: ")) {
+        case 1: query.onlySick = true; break;
+        case 2: query.onlyHungry = true; break;
+        case 3: query.onlyUnhappy = true; break;
+        case 4:
+            wcout << L"Введите вид (например, Лев): ";
+            query.species = EventLoop::instance().readText();
+            break;
+        case 5:
+            query.enclosureIndex = getIntInput(L"Введите номер вольера (0-" + to_wstring(enclosures.size() - 1) + L"): ");
+            if (query.enclosureIndex < 0 || query.enclosureIndex >= (int)enclosures.size()) {
+                wcout << L"Некорректный номер вольера.\n";
+                return;
             }
-            wcout << L", Хищник: " << (animal.isPredator ? L"Да" : L"Нет") << endl;
-            wcout << L"   Здоровье: " << (animal.isSick ? L"Больное" : L"Здоровое") << endl;
-            wcout << L"   Сытость: " << (animal.isHungry ? L"Голодное" : L"Сытое") << endl;
-            wcout << L"   Счастье: " << animal.happiness << L"/100" << endl;
+            break;
+        }
+
+        wcout << L"Сортировка: 0. Нет  1. По имени  2. По возрасту  3. По цене  4. По счастью\n";
+        int sortChoice = getIntInput(L"Ваш выбор: ");
+        if (sortChoice >= 1 && sortChoice <= 4) {
+            query.sort = static_cast<AnimalSort>(sortChoice);
+        }
+
+        vector<AnimalRef> found = queryAnimals(query);
+        wcout << L"\n=== Животные зоопарка ===\n";
+        if (herdLiving > 0) {
+            wcout << L"Животных в стадах: " << herdLiving << L" (в списке не показаны, см. меню стад)\n";
+        }
+        if (found.empty()) {
+            wcout << L"Нет животных, подходящих под условия.\n";
+            return;
         }
+
+        browsePages(found.size(), [&](wostringstream& buffer, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                const AnimalRef& ref = found[i];
+                const Enclosure& enclosure = as_const(enclosures)[ref.enclosureIndex];
+                const Animal& animal = enclosure.animals[ref.animalIndex];
+                buffer << i << L". " << animal.displayName() << L" (" << animal.specificType() << L")"
+                    << L" | Вольер " << ref.enclosureIndex << L": " << enclosure.name
+                    << L" | " << stateName(animal.state)
+                    << L" | Возраст: " << animal.age << L"д | Счастье: " << animal.happiness << L'\n';
+            }
+            });
     }
 
     // Метод отображения списка сотрудников
@@ -705,19 +4016,22 @@ public:
             return;
         }
 
-        for (size_t i = 0; i < workers.size(); ++i) {
-            const auto& worker = workers[i];
-            wcout << i << L". " << worker.name.c_str();
-            wcout << L" | Зарплата: " << worker.price;
-            wcout << L" | Роль: ";
-            switch (worker.role) {
-            case WorkerRole::DIRECTOR: wcout << L"Директор"; break;
-            case WorkerRole::VETERINAR: wcout << L"Ветеринар"; break;
-            case WorkerRole::CLEANER: wcout << L"Уборщик"; break;
-            case WorkerRole::FOODMEN: wcout << L"Кормильщик"; break;
+        browsePages(workers.size(), [&](wostringstream& buffer, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                const auto& worker = workers[i];
+                buffer << i << L". " << worker.name;
+                buffer << L" | Зарплата: " << worker.price;
+                buffer << L" | Эффективность: " << worker.efficiency;
+                buffer << L" | Роль: ";
+                switch (worker.role) {
+                case WorkerRole::DIRECTOR: buffer << L"Директор"; break;
+                case WorkerRole::VETERINAR: buffer << L"Ветеринар"; break;
+                case WorkerRole::CLEANER: buffer << L"Уборщик"; break;
+                case WorkerRole::FOODMEN: buffer << L"Кормильщик"; break;
+                }
+                buffer << L'\n';
             }
-            wcout << endl;
-        }
+            });
     }
 
     // Метод отображения списка вольеров
@@ -728,21 +4042,17 @@ public:
             return;
         }
 
-        for (size_t i = 0; i < enclosures.size(); ++i) {
-            const auto& enclosure = enclosures[i];
-            wcout << i << L". " << enclosure.name.c_str() << endl;
-            wcout << L"   Вместимость: " << enclosure.animals.size() << L"/" << enclosure.capacity << endl;
-            wcout << L"   Климат: ";
-            switch (enclosure.climate) {
-            case Climate::CONTINENT: wcout << L"Континент"; break;
-            case Climate::TROPIC: wcout << L"Тропики"; break;
-            case Climate::ARCTIC: wcout << L"Арктика"; break;
+        browsePages(enclosures.size(), [&](wostringstream& buffer, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                const auto& enclosure = as_const(enclosures)[i];
+                buffer << i << L". " << enclosure.name << L'\n';
+                buffer << L"   Вместимость: " << enclosure.occupancy() << L"/" << enclosure.capacity << L'\n';
+                buffer << L"   Климат: " << climateName(enclosure.climate) << L'\n';
+                buffer << L"   Для хищников: " << (enclosure.isPredatorEnclosure ? L"Да" : L"Нет") << L'\n';
+                buffer << L"   Для размножения: " << (enclosure.isBreedingEnclosure ? L"Да" : L"Нет") << L'\n';
+                buffer << L"   Уровень: " << enclosure.upgradeLevel << L"\n\n";
             }
-            wcout << endl;
-            wcout << L"   Для хищников: " << (enclosure.isPredatorEnclosure ? L"Да" : L"Нет") << endl;
-            wcout << L"   Для размножения: " << (enclosure.isBreedingEnclosure ? L"Да" : L"Нет") << endl;
-            wcout << L"   Уровень: " << enclosure.upgradeLevel << endl << endl;
-        }
+            });
     }
 
     // Метод отображения детальной информации о вольере
@@ -752,37 +4062,212 @@ public:
             return;
         }
 
-        const auto& enclosure = enclosures[index];
-        wcout << L"\n=== Подробная информация о вольере ===\n";
-        wcout << L"Название: " << enclosure.name.c_str() << endl;
-        wcout << L"Вместимость: " << enclosure.animals.size() << L"/" << enclosure.capacity << endl;
-        wcout << L"Климат: ";
-        switch (enclosure.climate) {
-        case Climate::CONTINENT: wcout << L"Континент"; break;
-        case Climate::TROPIC: wcout << L"Тропики"; break;
-        case Climate::ARCTIC: wcout << L"Арктика"; break;
+        const auto& enclosure = as_const(enclosures)[index];
+        wostringstream buffer;
+        buffer << L"\n=== Подробная информация о вольере ===\n";
+        buffer << L"Название: " << enclosure.name << L'\n';
+        buffer << L"Вместимость: " << enclosure.occupancy() << L"/" << enclosure.capacity << L'\n';
+        buffer << L"Климат: " << climateName(enclosure.climate) << L'\n';
+        buffer << L"Для хищников: " << (enclosure.isPredatorEnclosure ? L"Да" : L"Нет") << L'\n';
+        buffer << L"Для размножения: " << (enclosure.isBreedingEnclosure ? L"Да" : L"Нет") << L'\n';
+        buffer << L"Уровень: " << enclosure.upgradeLevel << L'\n';
+        buffer << L"Состояние: " << (enclosure.isDirty ? L"Грязный" : L"Чистый") << L'\n';
+        if (!enclosure.cohorts.empty()) {
+            buffer << L"\nСтада в вольере:\n";
+            for (const Cohort& cohort : enclosure.cohorts) renderCohort(buffer, cohort);
         }
-        wcout << endl;
-        wcout << L"Для хищников: " << (enclosure.isPredatorEnclosure ? L"Да" : L"Нет") << endl;
-        wcout << L"Для размножения: " << (enclosure.isBreedingEnclosure ? L"Да" : L"Нет") << endl;
-        wcout << L"Уровень: " << enclosure.upgradeLevel << endl;
-        wcout << L"Состояние: " << (enclosure.isDirty ? L"Грязный" : L"Чистый") << endl;
+        buffer << L"\nЖивотные в вольере:\n";
+        wcout << buffer.str();
 
-        wcout << L"\nЖивотные в вольере:\n";
         if (enclosure.animals.empty()) {
             wcout << L"Нет животных.\n";
+            return;
         }
-        else {
-            for (const auto& animal : enclosure.animals) {
-                wcout << L"Имя: " << animal.name.c_str() << endl;
-                wcout << L"Тип: " << (animal.diet == Diet::PREDATORS ? L"Хищник" : L"Травоядное") << endl;
-                wcout << L"Состояние: ";
-                switch (animal.state) {
-                case AnimalState::HEALTHY: wcout << L"Здоров"; break;
-                case AnimalState::SICK: wcout << L"Болен"; break;
-                case AnimalState::DEAD: wcout << L"Мертв"; break;
+
+        browsePages(enclosure.animals.size(), [&](wostringstream& page, size_t first, size_t last) {
+            for (size_t i = first; i < last; ++i) {
+                const Animal& animal = enclosure.animals[i];
+                page << L"Имя: " << animal.displayName() << L'\n';
+                page << L"Тип: " << (animal.diet == Diet::PREDATORS ? L"Хищник" : L"Травоядное") << L'\n';
+                page << L"Состояние: " << stateName(animal.state) << L"\n\n";
+            }
+            });
+    }
+
+    // Метод вывода строки о стаде в буфер
+    void renderCohort(wostringstream& buffer, const Cohort& cohort) {
+        buffer << cohort.prototype.specificType() << L", " << (cohort.prototype.female ? L"самки" : L"самцы")
+            << L", возраст " << cohort.prototype.age << L"д: здоровых " << cohort.healthy << L", больных " << cohort.sick << L'\n';
+    }
+
+    // Метод вывода всех стад и выбора одного из них ({-1, -1} - стадо не выбрано)
+    pair<int, int> chooseHerd(const wstring& prompt) {
+        vector<pair<int, int>> herds;
+        wostringstream buffer;
+        buffer << L"\n=== Стада ===\n";
+        for (size_t e = 0; e < enclosures.size(); e++) {
+            const Enclosure& enclosure = as_const(enclosures)[e];
+            for (size_t c = 0; c < enclosure.cohorts.size(); c++) {
+                buffer << herds.size() << L". \"" << enclosure.name << L"\": ";
+                renderCohort(buffer, enclosure.cohorts[c]);
+                herds.push_back({ (int)e, (int)c });
+            }
+        }
+        if (herds.empty()) {
+            wcout << L"Стад нет.\n";
+            return { -1, -1 };
+        }
+        wcout << buffer.str();
+        if (prompt.empty()) return { -1, -1 };
+
+        int choice = getIntInput(prompt + L" (0-" + to_wstring(herds.size() - 1) + L"): ");
+        if (choice < 0 || choice >= (int)herds.size()) {
+            wcout << L"Некорректный номер стада.\n";
+            return { -1, -1 };
+        }
+        return herds[choice];
+    }
+
+    // Метод покупки стада: несколько одинаковых животных из магазина без отдельных записей
+    void buyHerd() {
+        if (daysSurvived >= 10) {
+            wcout << L"После 10 дня можно покупать не более 1 животного в день, стада не продаются.\n";
+            return;
+        }
+        if (animalShop.empty() || enclosures.empty()) {
+            wcout << L"Нет животных в магазине или вольеров.\n";
+            return;
+        }
+
+        displayAnimalsList(animalShop.snapshot());
+        int shopIndex = getIntInput(L"Введите номер животного (0-" + to_wstring(animalShop.size() - 1) + L"): ");
+        if (shopIndex < 0 || shopIndex >= (int)animalShop.size()) {
+            wcout << L"Некорректный номер животного.\n";
+            return;
+        }
+        Animal animal = animalShop.get(shopIndex);
+        int count = getIntInput(L"Сколько таких животных купить? ");
+        if (count <= 0) return;
+
+        displayEnclosuresList();
+        int enclosureIndex = getIntInput(L"Введите номер вольера (0-" + to_wstring(enclosures.size() - 1) + L"): ");
+        if (enclosureIndex < 0 || enclosureIndex >= (int)enclosures.size()) {
+            wcout << L"Некорректный номер вольера.\n";
+            return;
+        }
+        const Enclosure& enclosure = as_const(enclosures)[enclosureIndex];
+        if (enclosure.animalType != animal.type() || enclosure.isPredatorEnclosure != (bool)animal.isPredator ||
+            (!enclosure.specificAnimalType.empty() && enclosure.specificAnimalType != animal.specificType())) {
+            wcout << L"Этот вольер не подходит для таких животных.\n";
+            return;
+        }
+        if (enclosure.occupancy() + count > enclosure.capacity) {
+            wcout << L"В вольере только " << enclosure.capacity - enclosure.occupancy() << L" свободных мест.\n";
+            return;
+        }
+        if (!enclosureSuits(enclosure, animal, count, false)) {
+            wcout << L"Для этих животных есть вольер с климатом " << climateName(animal.climate) << L", выберите его.\n";
+            return;
+        }
+        long long cost = (long long)animal.price * count;
+        if (money < cost) {
+            wcout << L"Недостаточно денег. Нужно: " << cost << endl;
+            return;
+        }
+
+        spend(LedgerCategory::ANIMAL_PURCHASE, (int)cost, enclosure.id);
+        animalShop.take(shopIndex);
+        addToHerd(enclosures[enclosureIndex], animal, count);
+        wcout << L"Куплено животных в стадо: " << count << endl;
+    }
+
+    // Метод размножения животных из двух стад одного вида (по одному животному из каждого
+    // выделяется в отдельную запись, потомок рождается в вольере первого стада)
+    void breedFromHerds() {
+        pair<int, int> first = chooseHerd(L"Первое стадо");
+        if (first.first < 0) return;
+        pair<int, int> second = chooseHerd(L"Второе стадо");
+        if (second.first < 0) return;
+        if (first == second) {
+            wcout << L"Выберите два разных стада.\n";
+            return;
+        }
+        const Cohort& firstHerd = as_const(enclosures)[first.first].cohorts[first.second];
+        const Cohort& secondHerd = as_const(enclosures)[second.first].cohorts[second.second];
+        if (firstHerd.prototype.specificType() != secondHerd.prototype.specificType()) {
+            wcout << L"Размножать можно только животных одного вида.\n";
+            return;
+        }
+        BreedingError error = Animal::checkBreeding(firstHerd.prototype, secondHerd.prototype);
+        if (error != BreedingError::NONE) {
+            wcout << L"Ошибка: " << breedingErrorText(error) << endl;
+            return;
+        }
+
+        // Если первое стадо опустеет, номера следующих за ним стад того же вольера сдвинутся
+        bool shifts = first.first == second.first && first.second < second.second && firstHerd.living() == 1;
+        size_t motherPosition = promoteFromHerd(enclosures[first.first], first.second);
+        Animal parent = as_const(enclosures)[first.first].animals[motherPosition];
+        size_t fatherPosition = promoteFromHerd(enclosures[second.first], second.second - (shifts ? 1 : 0));
+        Animal partner = as_const(enclosures)[second.first].animals[fatherPosition];
+
+        BreedingResult result = breed(parent, partner, enclosures[first.first]);
+        if (!result) {
+            wcout << L"Ошибка: " << breedingErrorText(result.error) << endl;
+            return;
+        }
+        wcout << L"Родился " << result.offspring.specificType() << L" по имени " << result.offspring.name << endl;
+    }
+
+    // Метод управления стадами
+    void manageHerds() {
+        int choice;
+        while (true) {
+            wcout << L"\n=== Стада ===\n";
+            wcout << L"1. Купить стадо\n";
+            wcout << L"2. Просмотреть стада\n";
+            wcout << L"3. Осмотреть животное из стада\n";
+            wcout << L"4. Переименовать животное из стада\n";
+            wcout << L"5. Размножить животных из стад\n";
+            wcout << L"6. Вернуться\n";
+            wcout << L"Выберите действие: ";
+            if (!EventLoop::instance().readInt(choice)) {
+                wcout << L"Ошибка: Введите число.\n";
+                continue;
+            }
+
+            switch (choice) {
+            case 1:
+                buyHerd();
+                break;
+            case 2:
+                chooseHerd(L"");
+                break;
+            case 3:
+            case 4: {
+                pair<int, int> herd = chooseHerd(L"Введите номер стада");
+                if (herd.first < 0) break;
+                Enclosure& enclosure = enclosures[herd.first];
+                size_t position = promoteFromHerd(enclosure, herd.second);
+                if (choice == 3) {
+                    wostringstream buffer;
+                    renderAnimalCard(buffer, position, as_const(enclosure.animals)[position]);
+                    wcout << buffer.str();
+                    break;
                 }
-                wcout << endl << endl;
+                wcout << L"Текущее имя: " << as_const(enclosure.animals)[position].name << endl;
+                wcout << L"Введите новое имя: ";
+                enclosure.animals.record(position).name = NameHandle::of(EventLoop::instance().readText());
+                wcout << L"Имя успешно изменено.\n";
+                break;
+            }
+            case 5:
+                breedFromHerds();
+                break;
+            case 6:
+                return;
+            default:
+                wcout << L"Некорректный ввод.\n";
             }
         }
     }
@@ -809,7 +4294,7 @@ public:
 
         for (size_t i = 0; i < enclosures[enclosureIndex].animals.size(); ++i) {
             const auto& animal = enclosures[enclosureIndex].animals[i];
-            wcout << i << L". " << animal.name.c_str() << endl;
+            wcout << i << L". " << animal.name << endl;
         }
 
         int animalIndex = getIntInput(L"Введите номер животного для переименования (0-" + to_wstring(enclosures[enclosureIndex].animals.size() - 1) + L"): ");
@@ -818,13 +4303,12 @@ public:
             return;
         }
 
-        wcout << L"Текущее имя: " << enclosures[enclosureIndex].animals[animalIndex].name.c_str() << endl;
+        wcout << L"Текущее имя: " << enclosures[enclosureIndex].animals[animalIndex].name << endl;
         wcout << L"Введите новое имя: ";
         wstring newName;
-        wcin >> ws;
-        getline(wcin, newName);
+        newName = EventLoop::instance().readText();
 
-        enclosures[enclosureIndex].animals[animalIndex].name = string(newName.begin(), newName.end());
+        enclosures[enclosureIndex].animals.record(animalIndex).name = NameHandle::of(newName);
         wcout << L"Имя успешно изменено.\n";
     }
 
@@ -853,7 +4337,7 @@ public:
         if (enclosure.isBreedingEnclosure && !enclosure.specificAnimalType.empty()) {
             bool hasSameType = true;
             for (const auto& animal : enclosure.animals) {
-                if (animal.specificType != enclosure.specificAnimalType) {
+                if (animal.specificType() != enclosure.specificAnimalType) {
                     hasSameType = false;
                     break;
                 }
@@ -866,7 +4350,7 @@ public:
 
         for (size_t i = 0; i < enclosure.animals.size(); ++i) {
             const auto& animal = enclosure.animals[i];
-            wcout << i << L". " << animal.name.c_str() << endl;
+            wcout << i << L". " << animal.name << endl;
         }
 
         int animalIndex1 = getIntInput(L"Введите номер первого животного (0-" + to_wstring(enclosure.animals.size() - 1) + L"): ");
@@ -883,32 +4367,219 @@ public:
             return;
         }
 
-        Animal& animal1 = enclosure.animals[animalIndex1];
-        Animal& animal2 = enclosure.animals[animalIndex2];
+        const Animal& animal1 = as_const(enclosure.animals)[animalIndex1];
+        const Animal& animal2 = as_const(enclosure.animals)[animalIndex2];
 
-        if (animal1.specificType != animal2.specificType) {
+        if (animal1.specificType() != animal2.specificType()) {
             wcout << L"Животные должны быть одного типа для размножения.\n";
             return;
         }
 
-        try {
-            // Попытка размножения с помощью перегруженного оператора +
-            Animal offspring = animal1 + animal2;
+        // Потомок создается прямо в вольере
+        BreedingResult result = breed(animal1, animal2, enclosure);
+        if (!result) {
+            wcout << L"Ошибка: " << breedingErrorText(result.error) << endl;
+            return;
+        }
 
-            if ((int)enclosure.animals.size() >= enclosure.capacity) {
-                wcout << L"В вольере нет места для потомства.\n";
-                return;
+        const Animal& offspring = result.offspring;
+        wcout << L"Родился новый " << offspring.specificType() << L" по имени " << offspring.name << endl;
+        wcout << L"Пол: " << offspring.gender() << L", вес: " << offspring.weight << L"кг" << endl;
+    }
+
+    // Метод оценки родства: 0 - родитель и потомок, 1 - общий родитель, 2 - не родственники
+    static int pedigreeDistance(const Animal& first, const Animal& second) {
+        int firstParents[2] = { first.parent1Id, first.parent2Id };
+        int secondParents[2] = { second.parent1Id, second.parent2Id };
+        for (int i = 0; i < 2; i++) {
+            if (firstParents[i] == second.id || secondParents[i] == first.id) return 0;
+        }
+        for (int i = 0; i < 2; i++) {
+            for (int j = 0; j < 2; j++) {
+                if (firstParents[i] != 0 && firstParents[i] == secondParents[j]) return 1;
             }
+        }
+        return 2;
+    }
 
-            // Добавление потомка в вольер
-            enclosure.animals.push_back(offspring);
-            animalsCount++;
-            wcout << L"Родился новый " << offspring.specificType << L" по имени " << offspring.wname << endl;
-            wcout << L"Пол: " << offspring.gender << L", вес: " << offspring.weight << L"кг" << endl;
+    // Метод подбора пар для размножения по всему зоопарку.
+    // Для каждого вида самцы и самки сортируются по ценности, и каждый самец
+    // выбирает лучшую по оценке партнерку из небольшого окна, поэтому время
+    // подбора почти линейно по числу животных.
+    vector<BreedingPair> planBreeding(int limit) const {
+        // Свободные места и подходящие вольеры (сначала вольеры для размножения)
+        vector<int> freeSlots(enclosures.size());
+        vector<int> enclosureOrder;
+        for (size_t i = 0; i < enclosures.size(); i++) {
+            freeSlots[i] = enclosures[i].capacity - as_const(enclosures)[i].occupancy();
+            enclosureOrder.push_back((int)i);
+        }
+        stable_sort(enclosureOrder.begin(), enclosureOrder.end(), [&](int a, int b) {
+            return enclosures[a].isBreedingEnclosure && !enclosures[b].isBreedingEnclosure;
+        });
+
+        struct Candidate {
+            AnimalRef ref;
+            int value;
+            int id;
+        };
+
+        // Виды перебираются в алфавитном порядке: они делят свободные места, а порядок
+        // пар в плане определяет номера потомков, поэтому он не должен зависеть от хэш-таблицы
+        vector<const wstring*> speciesOrder;
+        for (const auto& species : zooIndex->bySpecies) speciesOrder.push_back(&species.first);
+        sort(speciesOrder.begin(), speciesOrder.end(), [](const wstring* a, const wstring* b) { return *a < *b; });
+
+        vector<BreedingPair> plan;
+        for (const wstring* species : speciesOrder) {
+            vector<Candidate> males, females;
+            for (int id : zooIndex->bySpecies.at(*species)) {
+                int enclosureIndex = (int)zooIndex->enclosurePosition.at(zooIndex->enclosureOf.at(id));
+                const Enclosure& enclosure = enclosures[enclosureIndex];
+                int animalIndex = enclosure.findAnimal(id);
+                const Animal& animal = enclosure.animals[animalIndex];
+                if (animal.state != AnimalState::HEALTHY || animal.age <= BREEDING_AGE) continue;
+
+                Candidate candidate{ { enclosureIndex, animalIndex }, animal.price, id };
+                if (enclosure.isBreedingEnclosure) candidate.value += BREEDING_ENCLOSURE_BONUS;
+                (animal.female ? females : males).push_back(candidate);
+            }
+            if (males.empty() || females.empty()) continue;
+
+            auto byValue = [](const Candidate& a, const Candidate& b) {
+                return a.value != b.value ? a.value > b.value : a.id < b.id;
+            };
+            sort(males.begin(), males.end(), byValue);
+            sort(females.begin(), females.end(), byValue);
+
+            vector<bool> taken(females.size(), false);
+            size_t firstFree = 0;
+            for (const Candidate& male : males) {
+                while (firstFree < females.size() && taken[firstFree]) firstFree++;
+                if (firstFree == females.size()) break;
+
+                const Animal& father = animalAt(male.ref);
+                int best = -1;
+                int bestScore = 0;
+                int seen = 0;
+                for (size_t f = firstFree; f < females.size() && seen < BREEDING_SEARCH_WINDOW; f++) {
+                    if (taken[f]) continue;
+                    seen++;
+                    int distance = pedigreeDistance(father, animalAt(females[f].ref));
+                    if (distance == 0) continue;
+                    int score = distance * PEDIGREE_WEIGHT + male.value + females[f].value;
+                    if (best < 0 || score > bestScore) {
+                        best = (int)f;
+                        bestScore = score;
+                    }
+                }
+                if (best < 0) continue;
+
+                int target = breedingTarget(father, male.ref, females[best].ref, enclosureOrder, freeSlots);
+                if (target < 0) continue;
+
+                taken[best] = true;
+                freeSlots[target]--;
+                plan.push_back({ male.ref, females[best].ref, target, bestScore });
+            }
+        }
+
+        // В план попадают лучшие пары в пределах дневного лимита
+        stable_sort(plan.begin(), plan.end(), [](const BreedingPair& a, const BreedingPair& b) {
+            return a.score > b.score;
+        });
+        if ((int)plan.size() > limit) plan.resize(limit);
+        return plan;
+    }
+
+    // Метод выбора вольера для потомка: вольер родителей для размножения,
+    // затем любой подходящий вольер с местом (вольеры для размножения раньше)
+    int breedingTarget(const Animal& parent, AnimalRef male, AnimalRef female,
+        const vector<int>& enclosureOrder, const vector<int>& freeSlots) const {
+        for (int own : { female.enclosureIndex, male.enclosureIndex }) {
+            if (enclosures[own].isBreedingEnclosure && freeSlots[own] > 0) return own;
+        }
+        for (int i : enclosureOrder) {
+            const Enclosure& enclosure = enclosures[i];
+            if (freeSlots[i] <= 0 || enclosure.animalType != parent.type()) continue;
+            if (!enclosure.specificAnimalType.empty() && enclosure.specificAnimalType != parent.specificType()) continue;
+            if (enclosure.isPredatorEnclosure != parent.isPredator) continue;
+            return i;
+        }
+        return -1;
+    }
+
+    // Метод получения животного по положению (полная запись по значению)
+    Animal animalAt(AnimalRef ref) const {
+        return enclosures[ref.enclosureIndex].animals[ref.animalIndex];
+    }
+
+    // Метод размножения без исключений: потомок помещается в вольер target
+    BreedingResult breed(const Animal& first, const Animal& second, Enclosure& target) {
+        BreedingResult result;
+        result.error = Animal::checkBreeding(first, second);
+        if (result.error != BreedingError::NONE) return result;
+        if (target.occupancy() >= target.capacity) {
+            result.error = BreedingError::NO_SPACE;
+            return result;
+        }
+        if (rng.range(100) >= Animal::conceptionChance(first, second)) {
+            result.error = BreedingError::NO_CONCEPTION;
+            return result;
+        }
+
+        Animal& offspring = result.offspring;
+        offspring.initOffspring(first, second, rng);
+        offspring.id = nextAnimalId++;
+        target.animals.push_back(offspring);
+        target.countLiving(offspring, 1);
+        writeIndex().addAnimal(offspring, target.id);
+        stateDigest.toggle(StateDigest::animal(target.id, offspring));
+        animalsCount++;
+        return result;
+    }
+
+    // Метод выполнения плана размножения, возвращает число рождений
+    int breedPlanned(const vector<BreedingPair>& plan) {
+        int born = 0;
+        for (const BreedingPair& pair : plan) {
+            BreedingResult result = breed(animalAt(pair.male), animalAt(pair.female), enclosures[pair.targetEnclosure]);
+            if (!result) continue;
+            born++;
+            out() << L"Родился " << result.offspring.specificType() << L" по имени " << result.offspring.name
+                << L" в вольере \"" << as_const(enclosures)[pair.targetEnclosure].name << L"\"\n";
+        }
+        lastBreedingDay = day;
+        return born;
+    }
+
+    // Метод автоматического размножения по плану (не чаще раза в день)
+    void autoBreed() {
+        if (lastBreedingDay == day) {
+            wcout << L"Сегодня размножение по плану уже проводилось.\n";
+            return;
+        }
+
+        vector<BreedingPair> plan = planBreeding(BREEDING_BATCH_SIZE);
+        if (plan.empty()) {
+            wcout << L"Подходящих пар не найдено.\n";
+            return;
+        }
+
+        wcout << L"\n=== План размножения ===\n";
+        for (size_t i = 0; i < plan.size(); i++) {
+            const Animal& male = animalAt(plan[i].male);
+            const Animal& female = animalAt(plan[i].female);
+            wcout << i + 1 << L". " << male.specificType() << L": " << male.displayName() << L" + " << female.displayName()
+                << L" -> \"" << as_const(enclosures)[plan[i].targetEnclosure].name << L"\"\n";
         }
-        catch (const exception& e) {
-            wcout << L"Ошибка: " << e.what() << endl;
+
+        if (getIntInput(L"Провести размножение? (1 - да, 0 - нет): ") != 1) {
+            wcout << L"Размножение отменено.\n";
+            return;
         }
+        int born = breedPlanned(plan);
+        wcout << L"Родилось детенышей: " << born << endl;
     }
 
     // Метод управления животными (основное меню)
@@ -927,14 +4598,11 @@ public:
             wcout << L"7. Размножить животных\n";
             wcout << L"8. Просмотреть вольер\n";
             wcout << L"9. Лечить животных\n";
-            wcout << L"10. Вернуться\n";
+            wcout << L"10. Стада\n";
+            wcout << L"11. Вернуться\n";
             wcout << L"Выберите действие: ";
-            wcin >> choice;
-
-            if (wcin.fail()) {
+            if (!EventLoop::instance().readInt(choice)) {
                 wcout << L"Ошибка: Введите число.\n";
-                wcin.clear();
-                wcin.ignore(numeric_limits<streamsize>::max(), '\n');
                 continue;
             }
 
@@ -949,29 +4617,29 @@ public:
                 wcout << L"\n=== Магазин животных ===\n";
                 wcout << L"До следующего обновления: " << animalShop.daysUntilRefresh << L" дней\n";
 
-                if (animalShop.availableAnimals.empty()) {
+                if (animalShop.empty()) {
                     wcout << L"Нет доступных животных в магазине.\n";
                     break;
                 }
 
-                displayAnimalsList(animalShop.availableAnimals);
+                displayAnimalsList(animalShop.snapshot());
 
                 int buyChoice = getIntInput(L"\nВведите номер животного для покупки (или -1 для отмены): ");
                 if (buyChoice == -1) break;
 
-                if (buyChoice < 0 || buyChoice >= (int)animalShop.availableAnimals.size()) {
+                if (buyChoice < 0 || buyChoice >= (int)animalShop.size()) {
                     wcout << L"Некорректный номер животного.\n";
                     break;
                 }
 
-                const Animal& animalToBuy = animalShop.availableAnimals[buyChoice];
+                const Animal& animalToBuy = animalShop.get(buyChoice);
 
                 if (money < animalToBuy.price) {
                     wcout << L"Недостаточно денег для покупки.\n";
                     break;
                 }
 
-                if (food < 1) {
+                if (pantry.stock(animalToBuy.diet) < 1) {
                     wcout << L"Недостаточно еды для нового животного.\n";
                     break;
                 }
@@ -979,7 +4647,16 @@ public:
                 wcout << L"\nВыберите вольер для размещения животного:\n";
                 displayEnclosuresList();
 
-                int enclosureIndex = getIntInput(L"Введите номер вольера (0-" + to_wstring(enclosures.size() - 1) + L"): ");
+                int enclosureIndex = getIntInput(L"Введите номер вольера (0-" + to_wstring(enclosures.size() - 1) + L", -1 - подобрать автоматически): ");
+
+                if (enclosureIndex == -1) {
+                    Enclosure* suitable = findEnclosureFor(animalToBuy);
+                    if (suitable == nullptr) {
+                        wcout << L"Нет подходящего вольера со свободным местом.\n";
+                        break;
+                    }
+                    enclosureIndex = (int)zooIndex->enclosurePosition.at(suitable->id);
+                }
 
                 if (enclosureIndex < 0 || enclosureIndex >= (int)enclosures.size()) {
                     wcout << L"Некорректный номер вольера.\n";
@@ -989,12 +4666,12 @@ public:
                 Enclosure& enclosure = enclosures[enclosureIndex];
 
                 // Проверка совместимости животного и вольера
-                if (enclosure.animalType != animalToBuy.type) {
+                if (enclosure.animalType != animalToBuy.type()) {
                     wcout << L"Тип вольера не подходит для этого животного.\n";
                     break;
                 }
 
-                if (!enclosure.specificAnimalType.empty() && enclosure.specificAnimalType != animalToBuy.specificType) {
+                if (!enclosure.specificAnimalType.empty() && enclosure.specificAnimalType != animalToBuy.specificType()) {
                     wcout << L"Этот вольер предназначен только для: " << enclosure.specificAnimalType << L"\n";
                     break;
                 }
@@ -1005,21 +4682,23 @@ public:
                     break;
                 }
 
-                if ((int)enclosure.animals.size() >= enclosure.capacity) {
+                if (enclosure.occupancy() >= enclosure.capacity) {
                     wcout << L"В вольере нет свободного места.\n";
                     break;
                 }
 
                 // Покупка животного
-                money -= animalToBuy.price;
-                food -= 1;
+                spend(LedgerCategory::ANIMAL_PURCHASE, animalToBuy.price, enclosure.id);
+                pantry.consume(animalToBuy.diet, 1);
                 animalsCount++;
                 animalsBoughtToday++;
-                enclosure.animals.push_back(animalToBuy);
+                Animal purchased = animalToBuy;
+                purchased.id = nextAnimalId++;
+                placeAnimal(enclosure, purchased);
                 checkDelegationSatisfaction();
 
-                wcout << L"Животное " << animalToBuy.specificType << L" \"" << animalToBuy.wname << L"\" куплено и помещено в вольер \"" << enclosure.name.c_str() << L"\"\n";
-                animalShop.availableAnimals.erase(animalShop.availableAnimals.begin() + buyChoice);
+                wcout << L"Животное " << animalToBuy.specificType() << L" \"" << animalToBuy.name << L"\" куплено и помещено в вольер \"" << enclosure.name << L"\"\n";
+                animalShop.take(buyChoice);
                 break;
             }
             case 2: {
@@ -1044,7 +4723,7 @@ public:
 
                 for (size_t i = 0; i < enclosures[enclosureIndex].animals.size(); ++i) {
                     const auto& animal = enclosures[enclosureIndex].animals[i];
-                    wcout << i << L". " << animal.name.c_str() << L" ($" << animal.price / 2 << L")\n";
+                    wcout << i << L". " << animal.name << L" ($" << animal.price / 2 << L")\n";
                 }
 
                 int animalIndex = getIntInput(L"Введите номер животного для продажи (0-" + to_wstring(enclosures[enclosureIndex].animals.size() - 1) + L"): ");
@@ -1054,14 +4733,15 @@ public:
                     break;
                 }
 
-                wcout << L"Вы уверены, что хотите продать " << enclosures[enclosureIndex].animals[animalIndex].name.c_str() << L"? (1 - да, 0 - нет): ";
+                wcout << L"Вы уверены, что хотите продать " << enclosures[enclosureIndex].animals[animalIndex].name << L"? (1 - да, 0 - нет): ";
                 int confirm = getIntInput(L"");
 
                 if (confirm == 1) {
                     animalsCount--;
-                    money += enclosures[enclosureIndex].animals[animalIndex].price / 2;
+                    earn(LedgerCategory::ANIMAL_SALE, as_const(enclosures)[enclosureIndex].animals[animalIndex].price / 2,
+                        as_const(enclosures)[enclosureIndex].id);
                     wcout << L"Животное продано.\n";
-                    enclosures[enclosureIndex].animals.erase(enclosures[enclosureIndex].animals.begin() + animalIndex);
+                    removeAnimalAt(enclosures[enclosureIndex], animalIndex);
                     checkDelegationSatisfaction();
                 }
                 else {
@@ -1076,20 +4756,7 @@ public:
                     break;
                 }
 
-                for (size_t i = 0; i < enclosures.size(); ++i) {
-                    wcout << L"\nВольер " << i << L": " << enclosures[i].name.c_str() << endl;
-                    for (const auto& animal : enclosures[i].animals) {
-                        wcout << L"Имя: " << animal.name.c_str() << endl;
-                        wcout << L"Тип: " << (animal.diet == Diet::PREDATORS ? L"Хищник" : L"Травоядное") << endl;
-                        wcout << L"Состояние: ";
-                        switch (animal.state) {
-                        case AnimalState::HEALTHY: wcout << L"Здоров"; break;
-                        case AnimalState::SICK: wcout << L"Болен"; break;
-                        case AnimalState::DEAD: wcout << L"Мертв"; break;
-                        }
-                        wcout << endl << endl;
-                    }
-                }
+                browseAnimals();
                 break;
             }
             case 4: {
@@ -1113,7 +4780,7 @@ public:
 
                 for (size_t i = 0; i < enclosures[sourceEnclosureIndex].animals.size(); ++i) {
                     const auto& animal = enclosures[sourceEnclosureIndex].animals[i];
-                    wcout << i << L". " << animal.name.c_str() << endl;
+                    wcout << i << L". " << animal.name << endl;
                 }
 
                 int animalIndex = getIntInput(L"Введите номер животного для перемещения (0-" + to_wstring(enclosures[sourceEnclosureIndex].animals.size() - 1) + L"): ");
@@ -1133,21 +4800,21 @@ public:
                     break;
                 }
 
-                if ((int)enclosures[destinationEnclosureIndex].animals.size() >= enclosures[destinationEnclosureIndex].capacity) {
+                if (as_const(enclosures)[destinationEnclosureIndex].occupancy() >= enclosures[destinationEnclosureIndex].capacity) {
                     wcout << L"В вольере назначения недостаточно места.\n";
                     break;
                 }
 
-                Animal& animalToMove = enclosures[sourceEnclosureIndex].animals[animalIndex];
+                Animal animalToMove = as_const(enclosures)[sourceEnclosureIndex].animals[animalIndex];
                 Enclosure& destEnclosure = enclosures[destinationEnclosureIndex];
 
                 // Проверка совместимости
-                if (destEnclosure.animalType != animalToMove.type) {
+                if (destEnclosure.animalType != animalToMove.type()) {
                     wcout << L"Тип вольера не подходит для этого животного.\n";
                     break;
                 }
 
-                if (!destEnclosure.specificAnimalType.empty() && destEnclosure.specificAnimalType != animalToMove.specificType) {
+                if (!destEnclosure.specificAnimalType.empty() && destEnclosure.specificAnimalType != animalToMove.specificType()) {
                     wcout << L"Этот вольер предназначен только для: " << destEnclosure.specificAnimalType << L"\n";
                     break;
                 }
@@ -1159,8 +4826,8 @@ public:
                 }
 
                 // Перемещение животного
-                destEnclosure.animals.push_back(animalToMove);
-                enclosures[sourceEnclosureIndex].animals.erase(enclosures[sourceEnclosureIndex].animals.begin() + animalIndex);
+                removeAnimalAt(enclosures[sourceEnclosureIndex], animalIndex);
+                placeAnimal(destEnclosure, animalToMove);
                 wcout << L"Животное успешно перемещено.\n";
                 checkDelegationSatisfaction();
                 break;
@@ -1176,11 +4843,11 @@ public:
                 int shopChoice = getIntInput(L"");
 
                 if (shopChoice == 1) {
-                    displayAnimalsList(animalShop.availableAnimals);
+                    displayAnimalsList(animalShop.snapshot());
                 }
                 else if (shopChoice == 2) {
                     if (money >= 1000) {
-                        money -= 1000;
+                        spend(LedgerCategory::SHOP_REFRESH, 1000);
                         refreshAnimalShop();
                         wcout << L"Магазин животных обновлен!\n";
                     }
@@ -1194,7 +4861,12 @@ public:
                 renameAnimal();
                 break;
             case 7:
-                breedAnimals();
+                if (getIntInput(L"1. Выбрать пару вручную\n2. Подобрать пары автоматически\nВыберите способ: ") == 2) {
+                    autoBreed();
+                }
+                else {
+                    breedAnimals();
+                }
                 break;
             case 8: {
                 // Просмотр информации о вольере
@@ -1211,6 +4883,9 @@ public:
                 healthingAnimal();
                 break;
             case 10:
+                manageHerds();
+                break;
+            case 11:
                 return;
             default:
                 wcout << L"Некорректный ввод.\n";
@@ -1229,24 +4904,38 @@ public:
             wcout << L"2. Заказать рекламу\n";
             wcout << L"3. Вернуться\n";
             wcout << L"Выберите действие: ";
-            wcin >> choice;
-
-            if (wcin.fail()) {
+            if (!EventLoop::instance().readInt(choice)) {
                 wcout << L"Ошибка: Введите число.\n";
-                wcin.clear();
-                wcin.ignore(numeric_limits<streamsize>::max(), '\n');
                 continue;
             }
 
             switch (choice) {
             case 1: {
                 // Покупка еды
-                int amount = getIntInput(L"Сколько еды купить? (1 еда = " + to_wstring(BASE_FOOD_COST) + L" денег): ");
-                int cost = amount * BASE_FOOD_COST;
-                if (money >= cost) {
-                    money -= cost;
-                    food += amount;
-                    wcout << L"Куплено " << amount << L" еды.\n";
+                wcout << L"Тип еды:\n1. " << foodName(Diet::PREDATORS) << L" (для хищников)\n2. "
+                    << foodName(Diet::HERBIVORES) << L" (для травоядных)\n";
+                Diet diet = getIntInput(L"Ваш выбор: ") == 1 ? Diet::PREDATORS : Diet::HERBIVORES;
+                int amount = getIntInput(L"Сколько еды купить? (1 еда = " + to_wstring(BASE_FOOD_COST) + L" денег, срок годности "
+                    + to_wstring(FOOD_SHELF_LIFE) + L" дней): ");
+                if (amount <= 0) {
+                    wcout << L"Некорректное количество.\n";
+                    break;
+                }
+
+                int delivery = getIntInput(L"1. Купить сразу\n2. Оптовый заказ (цена " + to_wstring(BULK_FOOD_PRICE_PERCENT)
+                    + L"%, доставка через " + to_wstring(FOOD_DELIVERY_DAYS) + L" дня)\nВаш выбор: ");
+                if (delivery == 2) {
+                    if (orderFood(diet, amount)) {
+                        wcout << L"Заказано " << amount << L" еды (" << foodName(diet) << L").\n";
+                    }
+                    else {
+                        wcout << L"Недостаточно денег для заказа.\n";
+                    }
+                    break;
+                }
+
+                if (buyFood(diet, amount)) {
+                    wcout << L"Куплено " << amount << L" еды (" << foodName(diet) << L").\n";
                 }
                 else {
                     wcout << L"Недостаточно денег для покупки.\n";
@@ -1256,7 +4945,7 @@ public:
             case 2: {
                 // Заказ рекламы
                 if (money >= ADVERTISEMENT_COST) {
-                    money -= ADVERTISEMENT_COST;
+                    spend(LedgerCategory::ADVERTISING, ADVERTISEMENT_COST);
                     popularity = min(MAX_POPULARITY, popularity + 5);
                     visitors += 10;
                     wcout << L"Рекламная кампания проведена. Популярность +5, посетители +10.\n";
@@ -1288,27 +4977,22 @@ public:
             wcout << L"5. Просмотреть вольер\n";
             wcout << L"6. Вернуться\n";
             wcout << L"Выберите действие: ";
-            wcin >> choice;
-
-            if (wcin.fail()) {
+            if (!EventLoop::instance().readInt(choice)) {
                 wcout << L"Ошибка: Введите число.\n";
-                wcin.clear();
-                wcin.ignore(numeric_limits<streamsize>::max(), '\n');
                 continue;
             }
 
             switch (choice) {
             case 1: {
                 // Строительство обычного вольера
-                if (money < BASE_ENCLOSURE_COST) {
+                if (money < enclosureBuildCost(EnclosureKind::REGULAR)) {
                     wcout << L"Недостаточно денег для строительства вольера.\n";
                     break;
                 }
 
                 wstring enclosureName;
                 wcout << L"Введите название вольера: ";
-                wcin >> ws;
-                getline(wcin, enclosureName);
+                enclosureName = EventLoop::instance().readText();
 
                 wstring climate = chooseClimate();
                 wstring animalType = chooseAnimalType();
@@ -1316,24 +5000,18 @@ public:
                 // Определение, будет ли вольер для хищников
                 bool isPredatorEnclosure = false;
                 if (animalType == L"Кошачьи") isPredatorEnclosure = true;
-                else if (animalType == L"Псовые") isPredatorEnclosure = (rand() % 5 != 0);
-                else if (animalType == L"Птицы") isPredatorEnclosure = (rand() % 3 == 0);
-                else if (animalType == L"Пресмыкающиеся") isPredatorEnclosure = (rand() % 2 == 0);
-                else if (animalType == L"Морские") isPredatorEnclosure = (rand() % 3 != 0);
+                else if (animalType == L"Псовые") isPredatorEnclosure = (rng.range(5) != 0);
+                else if (animalType == L"Птицы") isPredatorEnclosure = (rng.range(3) == 0);
+                else if (animalType == L"Пресмыкающиеся") isPredatorEnclosure = (rng.range(2) == 0);
+                else if (animalType == L"Морские") isPredatorEnclosure = (rng.range(3) != 0);
 
                 // Создание нового вольера
-                Enclosure newEnclosure;
-                newEnclosure.name = string(enclosureName.begin(), enclosureName.end());
-                newEnclosure.capacity = 2;
+                Enclosure newEnclosure = Enclosure::make(EnclosureKind::REGULAR, static_cast<Climate>(rng.range(3)));
+                newEnclosure.name = NameHandle::of(enclosureName);
                 newEnclosure.animalType = animalType;
-                newEnclosure.climate = static_cast<Climate>(rand() % 3);
-                newEnclosure.dailyCost = 50;
                 newEnclosure.isPredatorEnclosure = isPredatorEnclosure;
-                newEnclosure.isBreedingEnclosure = false;
-                newEnclosure.upgradeLevel = 1;
 
-                money -= BASE_ENCLOSURE_COST;
-                enclosures.push_back(newEnclosure);
+                spend(LedgerCategory::CONSTRUCTION, enclosureBuildCost(EnclosureKind::REGULAR), addEnclosure(newEnclosure).id);
                 wcout << L"Вольер \"" << enclosureName << L"\" построен.\n";
                 wcout << L"Этот вольер " << (isPredatorEnclosure ? L"для хищников" : L"не для хищников") << L".\n";
                 checkDelegationSatisfaction();
@@ -1341,15 +5019,14 @@ public:
             }
             case 2: {
                 // Строительство вольера для размножения
-                if (money < BREEDING_ENCLOSURE_COST) {
+                if (money < enclosureBuildCost(EnclosureKind::BREEDING)) {
                     wcout << L"Недостаточно денег для строительства вольера для размножения.\n";
                     break;
                 }
 
                 wstring enclosureName;
                 wcout << L"Введите название вольера: ";
-                wcin >> ws;
-                getline(wcin, enclosureName);
+                enclosureName = EventLoop::instance().readText();
 
                 wstring climate = chooseClimate();
                 wstring animalType = chooseAnimalType();
@@ -1358,19 +5035,13 @@ public:
                 bool isPredatorEnclosure = isPredatorAnimal(specificType);
 
                 // Создание вольера для размножения
-                Enclosure newEnclosure;
-                newEnclosure.name = string(enclosureName.begin(), enclosureName.end());
-                newEnclosure.capacity = 3;
+                Enclosure newEnclosure = Enclosure::make(EnclosureKind::BREEDING, static_cast<Climate>(rng.range(3)));
+                newEnclosure.name = NameHandle::of(enclosureName);
                 newEnclosure.animalType = animalType;
                 newEnclosure.specificAnimalType = specificType;
-                newEnclosure.climate = static_cast<Climate>(rand() % 3);
-                newEnclosure.dailyCost = 80;
                 newEnclosure.isPredatorEnclosure = isPredatorEnclosure;
-                newEnclosure.isBreedingEnclosure = true;
-                newEnclosure.upgradeLevel = 1;
 
-                money -= BREEDING_ENCLOSURE_COST;
-                enclosures.push_back(newEnclosure);
+                spend(LedgerCategory::CONSTRUCTION, enclosureBuildCost(EnclosureKind::BREEDING), addEnclosure(newEnclosure).id);
                 wcout << L"Вольер для размножения \"" << enclosureName << L"\" построен.\n";
                 wcout << L"Этот вольер предназначен для: " << specificType << L" (" << (isPredatorEnclosure ? L"хищник" : L"не хищник") << L")\n";
                 checkDelegationSatisfaction();
@@ -1392,25 +5063,23 @@ public:
                 }
 
                 Enclosure& enclosure = enclosures[enclosureIndex];
-                if (enclosure.upgradeLevel >= 5) {
+                const EnclosureLevel& current = enclosure.economics();
+                if (current.upgradeCost == 0) {
                     wcout << L"Этот вольер уже максимально улучшен.\n";
                     break;
                 }
 
-                int upgradeCost = 200 * enclosure.upgradeLevel;
-                wcout << L"Стоимость улучшения: " << upgradeCost << L" денег\n";
+                const EnclosureLevel& next = enclosureLevel(enclosure.kind(), enclosure.upgradeLevel + 1);
+                wcout << L"Стоимость улучшения: " << current.upgradeCost << L" денег\n";
                 wcout << L"Текущая вместимость: " << enclosure.capacity << endl;
-                wcout << L"Новая вместимость: " << enclosure.capacity + (enclosure.isBreedingEnclosure ? 3 : 2) << endl;
+                wcout << L"Новая вместимость: " << enclosure.capacity + next.capacity - current.capacity << endl;
+                wcout << L"Расходы в день: " << enclosure.dailyCost + next.dailyCost - current.dailyCost << endl;
 
-                if (money < upgradeCost) {
+                if (!upgradeEnclosure(enclosure)) {
                     wcout << L"Недостаточно денег для улучшения.\n";
                     break;
                 }
 
-                money -= upgradeCost;
-                enclosure.capacity += (enclosure.isBreedingEnclosure ? 3 : 2);
-                enclosure.dailyCost += 20;
-                enclosure.upgradeLevel++;
                 wcout << L"Вольер улучшен до уровня " << enclosure.upgradeLevel << L". Новая вместимость: " << enclosure.capacity << endl;
                 break;
             }
@@ -1430,23 +5099,20 @@ public:
                 }
 
                 Enclosure& enclosure = enclosures[enclosureIndex];
-                if (!enclosure.animals.empty()) {
+                if (!enclosure.animals.empty() || !enclosure.cohorts.empty()) {
                     wcout << L"Нельзя продать вольер с животными. Сначала переместите или продайте животных.\n";
                     break;
                 }
 
                 // Расчет стоимости продажи
-                int sellPrice = 300 + (enclosure.upgradeLevel - 1) * 100;
-                if (enclosure.isBreedingEnclosure) {
-                    sellPrice += 200;
-                }
+                int sellPrice = enclosure.economics().salePrice;
                 wcout << L"Вы получите " << sellPrice << L" за продажу этого вольера.\n";
-                wcout << L"Вы уверены, что хотите продать вольер \"" << enclosure.name.c_str() << L"\"? (1 - да, 0 - нет): ";
+                wcout << L"Вы уверены, что хотите продать вольер \"" << enclosure.name << L"\"? (1 - да, 0 - нет): ";
                 int confirm = getIntInput(L"");
 
                 if (confirm == 1) {
-                    money += sellPrice;
-                    enclosures.erase(enclosures.begin() + enclosureIndex);
+                    earn(LedgerCategory::ENCLOSURE_SALE, sellPrice, enclosure.id);
+                    removeEnclosureAt(enclosureIndex);
                     wcout << L"Вольер продан.\n";
                 }
                 else {
@@ -1485,12 +5151,8 @@ public:
             wcout << L"3. Уволить сотрудника\n";
             wcout << L"4. Вернуться\n";
             wcout << L"Выберите действие: ";
-            wcin >> choice;
-
-            if (wcin.fail()) {
+            if (!EventLoop::instance().readInt(choice)) {
                 wcout << L"Ошибка: Введите число.\n";
-                wcin.clear();
-                wcin.ignore(numeric_limits<streamsize>::max(), '\n');
                 continue;
             }
 
@@ -1517,30 +5179,31 @@ public:
                 switch (positionChoice) {
                 case 1:
                     position = L"Ветеринар";
-                    salary = 60 + rand() % 41; // 60-100
-                    efficiency = 50 + rand() % 51; // 50-100
-                    workers.emplace_back(string(name.begin(), name.end()), salary, WorkerRole::VETERINAR);
+                    salary = 60 + rng.range(41); // 60-100
+                    efficiency = 50 + rng.range(51); // 50-100
+                    workers.emplace_back(NameHandle::of(name), salary, WorkerRole::VETERINAR);
                     break;
                 case 2:
                     position = L"Уборщик";
-                    salary = 40 + rand() % 31; // 40-70
-                    efficiency = 70 + rand() % 31; // 70-100
-                    workers.emplace_back(string(name.begin(), name.end()), salary, WorkerRole::CLEANER);
+                    salary = 40 + rng.range(31); // 40-70
+                    efficiency = 70 + rng.range(31); // 70-100
+                    workers.emplace_back(NameHandle::of(name), salary, WorkerRole::CLEANER);
                     break;
                 case 3:
                     position = L"Смотритель";
-                    salary = 50 + rand() % 51; // 50-100
-                    efficiency = 60 + rand() % 41; // 60-100
-                    workers.emplace_back(string(name.begin(), name.end()), salary, WorkerRole::FOODMEN);
+                    salary = 50 + rng.range(51); // 50-100
+                    efficiency = 60 + rng.range(41); // 60-100
+                    workers.emplace_back(NameHandle::of(name), salary, WorkerRole::FOODMEN);
                     break;
                 default:
                     wcout << L"Некорректный выбор. Назначаем смотрителем.\n";
                     position = L"Смотритель";
-                    salary = 50 + rand() % 51;
-                    efficiency = 60 + rand() % 41;
-                    workers.emplace_back(string(name.begin(), name.end()), salary, WorkerRole::FOODMEN);
+                    salary = 50 + rng.range(51);
+                    efficiency = 60 + rng.range(41);
+                    workers.emplace_back(NameHandle::of(name), salary, WorkerRole::FOODMEN);
                 }
 
+                workers.back().efficiency = efficiency;
                 wcout << L"Нанят новый сотрудник: " << name << L" (" << position << L")\n";
                 wcout << L"Зарплата: " << salary << L", Эффективность: " << efficiency << endl;
                 break;
@@ -1564,13 +5227,13 @@ public:
                     break;
                 }
 
-                wcout << L"Вы уверены, что хотите уволить " << workers[employeeIndex].name.c_str() << L"? (1 - да, 0 - нет): ";
+                wcout << L"Вы уверены, что хотите уволить " << workers[employeeIndex].name << L"? (1 - да, 0 - нет): ";
                 int confirm = getIntInput(L"");
 
                 if (confirm == 1) {
-                    string name = workers[employeeIndex].name;
+                    NameHandle name = workers[employeeIndex].name;
                     workers.erase(workers.begin() + employeeIndex);
-                    wcout << L"Сотрудник " << name.c_str() << L" уволен.\n";
+                    wcout << L"Сотрудник " << name << L" уволен.\n";
                 }
                 else {
                     wcout << L"Увольнение отменено.\n";
@@ -1588,13 +5251,16 @@ public:
     // Метод обновления уровня счастья животных
     void updateAnimalHappiness() {
         for (auto& enclosure : enclosures) {
-            for (auto& animal : enclosure.animals) {
+            for (AnimalVitals& animal : enclosure.animals.allVitals()) {
+                uint64_t before = StateDigest::animal(enclosure.id, animal);
+                int oldHappiness = animal.happiness;
+
                 // Уменьшение счастья в зависимости от состояния
                 if (animal.isHungry) {
                     animal.happiness = max(0, animal.happiness - 15);
                 }
 
-                if (animal.isSick) {
+                if (animal.state == AnimalState::SICK) {
                     animal.happiness = max(0, animal.happiness - 20);
                 }
 
@@ -1603,28 +5269,43 @@ public:
                 }
 
                 // Увеличение счастья, если все хорошо
-                if (!animal.isHungry && !animal.isSick && !enclosure.isDirty) {
+                if (!animal.isHungry && animal.state != AnimalState::SICK && !enclosure.isDirty) {
                     animal.happiness = min(100, animal.happiness + 5);
                 }
 
                 animal.isUnhappy = (animal.happiness < 50);
+                if (animal.state != AnimalState::DEAD) enclosure.happinessSum += animal.happiness - oldHappiness;
+                stateDigest.replace(before, StateDigest::animal(enclosure.id, animal));
             }
         }
     }
 
-    // Метод проверки старения и смерти животных
-    void checkAnimalAgingAndDeath() {
+    // Метод старения животных за день и смерти от старости (вызывается каждый день,
+    // report = false - без сообщений, для тихих дней)
+    void checkAnimalAgingAndDeath(bool report = true) {
         for (auto& enclosure : enclosures) {
             for (size_t i = 0; i < enclosure.animals.size(); ) {
-                Animal& animal = enclosure.animals[i];
+                if (as_const(enclosure.animals).vitals(i).state == AnimalState::DEAD) {
+                    i++;
+                    continue;
+                }
+                AnimalVitals& animal = enclosure.animals.vitals(i);
+                uint64_t before = StateDigest::animal(enclosure.id, animal);
                 animal.age++;
+                stateDigest.replace(before, StateDigest::animal(enclosure.id, animal));
 
-                // Проверка на смерть от старости
-                if (animal.age > OLD_AGE_THRESHOLD) {
-                    int deathChance = min(99, (animal.age - OLD_AGE_THRESHOLD) / 10);
-                    if (rand() % 100 < deathChance) {
-                        wcout << L"Животное " << animal.name.c_str() << L" (" << animal.specificType << L") умерло от старости в возрасте " << animal.age << L" дней.\n";
-                        enclosure.animals.erase(enclosure.animals.begin() + i);
+                // Проверка на смерть от старости (гены читаются, только если животное
+                // старо хотя бы при самом слабом гене долголетия)
+                if ((int)animal.age <= Animal::EARLIEST_OLD_AGE) {
+                    i++;
+                    continue;
+                }
+                const AnimalRecord& record = as_const(enclosure.animals).record(i);
+                int deathChance = Animal::oldAgeDeathChance(animal.age, record.genome);
+                if (deathChance > 0) {
+                    if (rng.range(100) < deathChance) {
+                        if (report) out() << L"Животное " << record.name << L" (" << speciesName(animal.species) << L") умерло от старости в возрасте " << animal.age << L" дней.\n";
+                        removeAnimalAt(enclosure, i);
                         animalsCount--;
                         continue;
                     }
@@ -1636,24 +5317,8 @@ public:
 
     // Метод проверки удовлетворенности делегации
     void checkDelegationSatisfaction() {
-        bool hasMarineEnclosure = false;
-        for (const auto& enclosure : enclosures) {
-            if (enclosure.animalType == L"Морские") {
-                hasMarineEnclosure = true;
-                break;
-            }
-        }
-
-        bool hasMarineAnimals = false;
-        for (const auto& enclosure : enclosures) {
-            for (const auto& animal : enclosure.animals) {
-                if (animal.type == L"Морские") {
-                    hasMarineAnimals = true;
-                    break;
-                }
-            }
-            if (hasMarineAnimals) break;
-        }
+        bool hasMarineEnclosure = zooIndex->enclosureTypeCount.count(L"Морские") > 0;
+        bool hasMarineAnimals = ZooIndex::countOf(zooIndex->byType, wstring(L"Морские")) > 0;
 
         delegationSatisfied = hasMarineEnclosure && hasMarineAnimals;
 
@@ -1663,26 +5328,66 @@ public:
         }
     }
 
+    // Метод вывода финансового отчета за последние дни
+    void displayFinanceReport() {
+        int days = getIntInput(L"За сколько последних дней показать отчет? ");
+        if (days <= 0) days = day + 1;
+        int fromDay = max(0, day - days + 1);
+
+        wostringstream buffer;
+        buffer << L"\n=== Финансы за дни " << fromDay << L"-" << day << L" ===\n";
+        for (int c = 0; c < (int)LedgerCategory::COUNT; c++) {
+            long long amount = ledger.total((LedgerCategory)c, fromDay, day);
+            if (amount != 0) {
+                buffer << ledgerCategoryName((LedgerCategory)c) << L": " << amount << L'\n';
+            }
+        }
+        buffer << L"Итого: " << ledger.net(fromDay, day) << L'\n';
+
+        // Самые прибыльные и убыточные вольеры
+        vector<pair<long long, int>> profits;
+        for (const Enclosure& enclosure : as_const(enclosures)) {
+            profits.push_back({ ledger.enclosureProfit(enclosure.id, fromDay, day), enclosure.id });
+        }
+        sort(profits.rbegin(), profits.rend());
+        if (!profits.empty()) {
+            buffer << L"\nПрибыль по вольерам:\n";
+            for (size_t i = 0; i < profits.size() && i < LIST_PAGE_SIZE; i++) {
+                const Enclosure& enclosure = as_const(enclosures)[zooIndex->enclosurePosition.at(profits[i].second)];
+                buffer << L"  " << enclosure.name << L" (ID " << enclosure.id << L"): " << profits[i].first << L'\n';
+            }
+        }
+        buffer << L"Операций в журнале: " << ledger.size() << L'\n';
+        wcout << buffer.str();
+    }
+
     // Главное меню игры
     void menu() {
+        static const wchar_t* const mainMenu =
+            L"\n=== Главное меню ===\n"
+            L"1. Управление животными\n"
+            L"2. Управление закупками\n"
+            L"3. Управление вольерами\n"
+            L"4. Управление персоналом\n"
+            L"5. Следующий день\n"
+            L"6. Перемотать время\n"
+            L"7. Прогноз (что если)\n"
+            L"8. Финансовый отчет\n"
+            L"9. Использование памяти\n"
+            L"10. Реальное время\n"
+            L"11. Выход\n"
+            L"Выберите действие: ";
+
+        // Панель статуса перерисовывается только в изменившихся строках
+        ScreenRenderer screen(ScreenRenderer::enableTerminal());
         int choice;
         while (true) {
-            displayStatus();
-
-            wcout << L"\n=== Главное меню ===\n";
-            wcout << L"1. Управление животными\n";
-            wcout << L"2. Управление закупками\n";
-            wcout << L"3. Управление вольерами\n";
-            wcout << L"4. Управление персоналом\n";
-            wcout << L"5. Следующий день\n";
-            wcout << L"6. Выход\n";
-            wcout << L"Выберите действие: ";
-            wcin >> choice;
+            screen.present(statusLines());
 
-            if (wcin.fail()) {
+            wcout << mainMenu;
+            // Пока игрок думает, в фоне выполняются долгие задачи (перемотка)
+            if (!EventLoop::instance().readInt(choice, L"Выберите действие: ")) {
                 wcout << L"Ошибка: Введите число.\n";
-                wcin.clear();
-                wcin.ignore(numeric_limits<streamsize>::max(), '\n');
                 continue;
             }
 
@@ -1699,10 +5404,41 @@ public:
             case 4:
                 manageEmployees();
                 break;
-            case 5:
+            case 5: {
+                finishBackgroundTasks();
+                auto start = chrono::steady_clock::now();
                 nextDay();
+                recordTick(start);
                 break;
-            case 6:
+            }
+            case 6: {
+                if (EventLoop::instance().taskCount() > 0) {
+                    if (getBoolInput(L"Перемотка уже идет. Отменить ее? (1 - да, 0 - нет): ")) {
+                        EventLoop::instance().cancelAll();
+                    }
+                    break;
+                }
+                if (daysWithoutAction > 0) {
+                    wcout << L"Дней без действий: " << daysWithoutAction << endl;
+                }
+                int days = getIntInput(L"На сколько дней перемотать? ");
+                if (days > 0) fastForwardAsync(days);
+                break;
+            }
+            case 7:
+                forecast();
+                break;
+            case 8:
+                displayFinanceReport();
+                break;
+            case 9:
+                displayMemoryReport();
+                break;
+            case 10:
+                finishBackgroundTasks();
+                realTimeMode(screen);
+                break;
+            case 11:
                 return;
             default:
                 wcout << L"Некорректный ввод.\n";
@@ -1711,6 +5447,328 @@ public:
     }
 };
 
+// Структура MarketOrder - заявка на рынке животных
+struct MarketOrder {
+    int zooIndex = 0;    // Номер зоопарка в мире
+    int enclosureId = 0; // Вольер продавца (только для продажи)
+    int animalId = 0;    // ID продаваемого животного (только для продажи)
+    int price = 0;       // Цена продажи или максимальная цена покупки
+};
+
+// Структура MarketTrade - сделка, найденная при сопоставлении заявок
+struct MarketTrade {
+    int sellerIndex = 0; // Зоопарк-продавец
+    int buyerIndex = 0;  // Зоопарк-покупатель
+    int enclosureId = 0; // Вольер продавца
+    int animalId = 0;    // ID животного у продавца
+    int price = 0;       // Цена сделки
+};
+
+// Класс AnimalMarketplace - центральная книга заявок на покупку и продажу животных.
+// Заявки копятся в течение дня и сопоставляются одной пачкой по каждому виду.
+class AnimalMarketplace {
+public:
+    // Виды упорядочены: от порядка сделок зависит, хватит ли покупателю денег
+    map<wstring, vector<MarketOrder>> asks; // Заявки на продажу по видам
+    map<wstring, vector<MarketOrder>> bids; // Заявки на покупку по видам
+
+    // Метод размещения заявки на продажу
+    void postAsk(const wstring& species, const MarketOrder& order) {
+        asks[species].push_back(order);
+    }
+
+    // Метод размещения заявки на покупку
+    void postBid(const wstring& species, const MarketOrder& order) {
+        bids[species].push_back(order);
+    }
+
+    // Метод сопоставления заявок: самые дешевые предложения достаются самым щедрым покупателям.
+    // После сопоставления книга очищается.
+    vector<MarketTrade> match() {
+        vector<MarketTrade> trades;
+        for (auto& entry : bids) {
+            auto found = asks.find(entry.first);
+            if (found == asks.end()) continue;
+
+            vector<MarketOrder>& buyOrders = entry.second;
+            vector<MarketOrder>& sellOrders = found->second;
+            stable_sort(sellOrders.begin(), sellOrders.end(), [](const MarketOrder& a, const MarketOrder& b) {
+                return a.price < b.price;
+                });
+            stable_sort(buyOrders.begin(), buyOrders.end(), [](const MarketOrder& a, const MarketOrder& b) {
+                return a.price > b.price;
+                });
+
+            // Покупатель получает самое дешевое непроданное предложение другого зоопарка
+            // (свое животное не покупаем, но и заявку из-за него не теряем)
+            vector<bool> sold(sellOrders.size(), false);
+            size_t firstUnsold = 0;
+            for (const MarketOrder& bid : buyOrders) {
+                while (firstUnsold < sellOrders.size() && sold[firstUnsold]) firstUnsold++;
+                if (firstUnsold == sellOrders.size() || bid.price < sellOrders[firstUnsold].price) break;
+
+                size_t sell = firstUnsold;
+                while (sell < sellOrders.size() && (sold[sell] || sellOrders[sell].zooIndex == bid.zooIndex)) sell++;
+                if (sell == sellOrders.size() || bid.price < sellOrders[sell].price) continue;
+
+                const MarketOrder& ask = sellOrders[sell];
+                trades.push_back({ ask.zooIndex, bid.zooIndex, ask.enclosureId, ask.animalId, (ask.price + bid.price) / 2 });
+                sold[sell] = true;
+            }
+        }
+
+        asks.clear();
+        bids.clear();
+        return trades;
+    }
+};
+
+// Класс World - регион из множества зоопарков с общим рынком животных.
+// Зоопарки обрабатываются параллельно группами (шардами), рынок - после них в одном потоке.
+class World {
+public:
+    vector<Zoo> zoos;              // Зоопарки региона
+    AnimalMarketplace marketplace; // Общий рынок животных
+    int day = 0;                   // Текущий день
+    int threadCount = 1;           // Количество потоков для обработки зоопарков
+    long long tradesTotal = 0;     // Всего совершено сделок
+    ZooMetrics* metrics = nullptr; // Показатели для экспорта метрик (сумма по зоопаркам)
+
+    // Конструктор: создает зоопарки с независимыми зернами и обустраивает их
+    World(int zooCount, uint32_t seed, int threads = 0) {
+        threadCount = threads > 0 ? threads : max(1, (int)thread::hardware_concurrency());
+        zoos.reserve(zooCount);
+        for (int i = 0; i < zooCount; i++) {
+            zoos.emplace_back(L"Зоопарк " + to_wstring(i + 1), GameRandom::mix(seed, i));
+            Zoo& zoo = zoos.back();
+            zoo.silent = true;
+            zoo.sandbox = true;
+            setupZoo(zoo);
+        }
+    }
+
+    // Метод начального обустройства: вольеры под ассортимент магазина и покупка животных
+    void setupZoo(Zoo& zoo) {
+        zoo.pantry.add(Diet::PREDATORS, 100, FOOD_SHELF_LIFE);
+        zoo.pantry.add(Diet::HERBIVORES, 100, FOOD_SHELF_LIFE);
+        // Один подборщик на всю закупку: новые вольеры добавляются в него по мере постройки
+        PlacementEngine engine(as_const(zoo.enclosures));
+        size_t position = 0;
+        while (position < zoo.animalShop.size()) {
+            const Animal& animal = zoo.animalShop.get(position);
+            int existing = engine.place(animal);
+            if (existing >= 0) {
+                engine.release(existing);
+            }
+            else {
+                Enclosure enclosure = Enclosure::make(EnclosureKind::REGULAR, animal.climate);
+                enclosure.animalType = animal.type();
+                enclosure.isPredatorEnclosure = animal.isPredator;
+                Enclosure& added = zoo.addEnclosure(enclosure);
+                zoo.spend(LedgerCategory::CONSTRUCTION, enclosureBuildCost(EnclosureKind::REGULAR), added.id);
+                engine.addEnclosure(added, zoo.enclosures.size() - 1);
+            }
+            if (!zoo.buyAnimal((int)position, engine)) position++;
+        }
+
+        // Один уборщик на каждые три вольера
+        for (size_t i = 0; i < zoo.enclosures.size(); i += 3) {
+            zoo.hireWorker(WorkerRole::CLEANER);
+        }
+    }
+
+    // Заявки, собранные одним шардом за день
+    struct ShardOrders {
+        vector<pair<wstring, MarketOrder>> asks;
+        vector<pair<wstring, MarketOrder>> bids;
+    };
+
+    // Метод выставления заявок зоопарка: из переполненных вольеров продается самое старое
+    // животное, в вольеры со свободным местом покупается тот же вид
+    void collectOrders(int index, Zoo& zoo, ShardOrders& orders) {
+        int demand[2];
+        zoo.foodDemand(demand);
+        for (int d = 0; d < 2; d++) {
+            if (zoo.pantry.stock((Diet)d) < demand[d] * 3) {
+                zoo.buyFood((Diet)d, demand[d] * 7);
+            }
+        }
+
+        for (const Enclosure& enclosure : zoo.enclosures) {
+            const AnimalVitals* oldest = nullptr;
+            for (const AnimalVitals& animal : enclosure.animals.allVitals()) {
+                if (animal.state == AnimalState::DEAD) continue;
+                if (oldest == nullptr || animal.age > oldest->age) oldest = &animal;
+            }
+            if (oldest == nullptr) continue;
+
+            if (enclosure.occupancy() >= enclosure.capacity) {
+                orders.asks.push_back({ speciesName(oldest->species), { index, enclosure.id, oldest->id, oldest->price } });
+            }
+            else {
+                int budget = min(zoo.money / 10, BASE_ANIMAL_PRICE);
+                if (budget > 0) {
+                    orders.bids.push_back({ speciesName(oldest->species), { index, 0, 0, budget } });
+                }
+            }
+        }
+    }
+
+    // Метод исполнения сделок: животное переходит от продавца к покупателю.
+    // Подборщик вольеров строится один раз на зоопарк за рыночный день.
+    void executeTrades(const vector<MarketTrade>& trades) {
+        unordered_map<int, PlacementEngine> engines;
+        auto engineOf = [&](int zooIndex) -> PlacementEngine& {
+            auto found = engines.find(zooIndex);
+            if (found == engines.end()) {
+                found = engines.emplace(zooIndex, PlacementEngine(as_const(zoos[zooIndex].enclosures))).first;
+            }
+            return found->second;
+        };
+
+        for (const MarketTrade& trade : trades) {
+            Zoo& seller = zoos[trade.sellerIndex];
+            Zoo& buyer = zoos[trade.buyerIndex];
+            if (buyer.money < trade.price) continue;
+
+            Enclosure* enclosure = seller.findEnclosure(trade.enclosureId);
+            if (enclosure == nullptr) continue;
+            int position = enclosure->findAnimal(trade.animalId);
+            if (position < 0) continue;
+
+            Animal traded = as_const(enclosure->animals)[position];
+            traded.price = trade.price;
+            if (!buyer.receiveAnimal(traded, engineOf(trade.buyerIndex))) continue;
+            seller.removeAnimalById(*enclosure, trade.animalId);
+            auto sellerEngine = engines.find(trade.sellerIndex);
+            if (sellerEngine != engines.end()) {
+                sellerEngine->second.release((int)seller.zooIndex->enclosurePosition.at(trade.enclosureId));
+            }
+            seller.animalsCount--;
+            buyer.spend(LedgerCategory::MARKET, trade.price);
+            seller.earn(LedgerCategory::MARKET, trade.price, trade.enclosureId);
+            tradesTotal++;
+        }
+    }
+
+    // Метод перехода мира на следующий день
+    void tick() {
+        day++;
+
+        // Параллельная обработка зоопарков: каждый поток получает непрерывный диапазон
+        int shardCount = max(1, min(threadCount, (int)zoos.size()));
+        size_t shardSize = (zoos.size() + shardCount - 1) / shardCount;
+        vector<ShardOrders> shardOrders(shardCount);
+        vector<thread> threads;
+        for (int shard = 0; shard < shardCount; shard++) {
+            threads.emplace_back([this, shard, shardSize, &shardOrders]() {
+                size_t begin = shard * shardSize;
+                size_t end = min(zoos.size(), begin + shardSize);
+                for (size_t i = begin; i < end; i++) {
+                    Zoo& zoo = zoos[i];
+                    if (zoo.bankrupt) continue;
+                    zoo.nextDay();
+                    if (!zoo.bankrupt) collectOrders((int)i, zoo, shardOrders[shard]);
+                }
+                });
+        }
+        for (auto& worker : threads) {
+            worker.join();
+        }
+
+        // Заявки переносятся на рынок в порядке номеров зоопарков, поэтому результат
+        // не зависит от количества потоков
+        for (const ShardOrders& orders : shardOrders) {
+            for (const auto& ask : orders.asks) marketplace.postAsk(ask.first, ask.second);
+            for (const auto& bid : orders.bids) marketplace.postBid(bid.first, bid.second);
+        }
+        executeTrades(marketplace.match());
+    }
+
+    // Хэш состояния всего мира (зоопарки объединяются по порядку номеров)
+    uint64_t digest() const {
+        uint64_t hash = StateDigest::combine((uint32_t)day, (uint64_t)tradesTotal);
+        for (const Zoo& zoo : zoos) {
+            hash = StateDigest::combine(hash, zoo.digest());
+        }
+        return hash;
+    }
+
+    // Метод публикации суммарных показателей мира за день, начавшийся в start
+    void publishMetrics(chrono::steady_clock::time_point start) {
+        if (metrics == nullptr) return;
+        metrics->tickLatency.record(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+        long long money = 0, food[2] = { 0, 0 }, popularity = 0, visitors = 0, animals[3] = { 0, 0, 0 };
+        for (const Zoo& zoo : zoos) {
+            money += zoo.money;
+            food[0] += zoo.pantry.stock(Diet::PREDATORS);
+            food[1] += zoo.pantry.stock(Diet::HERBIVORES);
+            popularity += zoo.popularity;
+            visitors += zoo.visitors;
+            for (int st = 0; st < 3; st++) animals[st] += zoo.getCountAnimal((AnimalState)st);
+        }
+        metrics->day.store(day, memory_order_relaxed);
+        metrics->money.store(money, memory_order_relaxed);
+        metrics->food[0].store(food[0], memory_order_relaxed);
+        metrics->food[1].store(food[1], memory_order_relaxed);
+        metrics->popularity.store(zoos.empty() ? 0 : popularity / (long long)zoos.size(), memory_order_relaxed);
+        metrics->visitors.store(visitors, memory_order_relaxed);
+        for (int st = 0; st < 3; st++) metrics->animals[st].store(animals[st], memory_order_relaxed);
+    }
+
+    // Метод подсчета зоопарков, у которых инкрементальный хэш разошелся с полным пересчетом
+    int digestMismatches() const {
+        int mismatches = 0;
+        for (const Zoo& zoo : zoos) {
+            if (zoo.digest() != zoo.recomputeDigest()) mismatches++;
+        }
+        return mismatches;
+    }
+
+    // Метод пакетного запуска симуляции с выводом итогов
+    // (traceDigest - выводить хэш состояния после каждого дня)
+    void run(int days, bool traceDigest = false) {
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < days; i++) {
+            auto dayStart = chrono::steady_clock::now();
+            tick();
+            publishMetrics(dayStart);
+            if (traceDigest) {
+                // Каждый день инкрементальный хэш сверяется с полным пересчетом
+                int mismatches = digestMismatches();
+                wcout << L"День " << day << L": " << hex << setw(16) << setfill(L'0') << digest() << dec << setfill(L' ');
+                if (mismatches > 0) wcout << L" (расхождений: " << mismatches << L")";
+                wcout << L'\n';
+            }
+        }
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+
+        int activeZoos = 0;
+        long long totalAnimals = 0;
+        long long totalMoney = 0;
+        for (const Zoo& zoo : zoos) {
+            if (zoo.bankrupt) continue;
+            activeZoos++;
+            totalAnimals += zoo.getCountAnimal();
+            totalMoney += zoo.money;
+        }
+
+        wcout << L"\n=== Итоги симуляции мира ===\n";
+        wcout << L"Дней: " << day << L", потоков: " << threadCount << endl;
+        wcout << L"Действующих зоопарков: " << activeZoos << L"/" << zoos.size() << endl;
+        wcout << L"Животных: " << totalAnimals << endl;
+        wcout << L"Деньги всех зоопарков: " << totalMoney << endl;
+        wcout << L"Сделок на рынке: " << tradesTotal << endl;
+        wcout << L"Время: " << elapsed << L" мс" << endl;
+        displayMemoryReport();
+
+        // Сверка инкрементального хэша с полным пересчетом (с --digest - еще и после каждого дня)
+        int mismatches = digestMismatches();
+        wcout << L"Хэш состояния: " << hex << setw(16) << setfill(L'0') << digest() << dec << setfill(L' ')
+            << (mismatches == 0 ? L" (сверен)" : L" (расхождений: " + to_wstring(mismatches) + L")") << endl;
+    }
+};
+
 // Вспомогательная функция для проверки, является ли животное хищником
 bool isPredatorAnimal(const wstring& specificType) {
     if (specificType == L"Лев" || specificType == L"Тигр" || specificType == L"Леопард" ||
@@ -1734,12 +5792,8 @@ wstring chooseClimate() {
         wcout << L"2. Умеренный\n";
         wcout << L"3. Арктический\n";
         wcout << L"Выберите номер климата: ";
-        wcin >> choice;
-
-        if (wcin.fail()) {
+        if (!EventLoop::instance().readInt(choice)) {
             wcout << L"Ошибка: Введите число.\n";
-            wcin.clear();
-            wcin.ignore(numeric_limits<streamsize>::max(), '\n');
             continue;
         }
 
@@ -1767,12 +5821,8 @@ wstring chooseAnimalType() {
         wcout << L"4. Пресмыкающиеся\n";
         wcout << L"5. Морские\n";
         wcout << L"Выберите номер типа: ";
-        wcin >> choice;
-
-        if (wcin.fail()) {
+        if (!EventLoop::instance().readInt(choice)) {
             wcout << L"Ошибка: Введите число.\n";
-            wcin.clear();
-            wcin.ignore(numeric_limits<streamsize>::max(), '\n');
             continue;
         }
 
@@ -1804,7 +5854,7 @@ wstring chooseSpecificAnimal(const wstring& type) {
         wcout << L"4. Рысь\n";
         wcout << L"5. Гепард\n";
         wcout << L"Выберите номер: ";
-        wcin >> choice;
+        EventLoop::instance().readInt(choice);
 
         switch (choice) {
         case 1: return L"Лев";
@@ -1824,7 +5874,7 @@ wstring chooseSpecificAnimal(const wstring& type) {
         wcout << L"4. Шакал\n";
         wcout << L"5. Гиена\n";
         wcout << L"Выберите номер: ";
-        wcin >> choice;
+        EventLoop::instance().readInt(choice);
 
         switch (choice) {
         case 1: return L"Собака";
@@ -1844,7 +5894,7 @@ wstring chooseSpecificAnimal(const wstring& type) {
         wcout << L"4. Сова\n";
         wcout << L"5. Фламинго\n";
         wcout << L"Выберите номер: ";
-        wcin >> choice;
+        EventLoop::instance().readInt(choice);
 
         switch (choice) {
         case 1: return L"Орел";
@@ -1864,7 +5914,7 @@ wstring chooseSpecificAnimal(const wstring& type) {
         wcout << L"4. Крокодил\n";
         wcout << L"5. Динозавр\n";
         wcout << L"Выберите номер: ";
-        wcin >> choice;
+        EventLoop::instance().readInt(choice);
 
         switch (choice) {
         case 1: return L"Змея";
@@ -1884,7 +5934,7 @@ wstring chooseSpecificAnimal(const wstring& type) {
         wcout << L"4. Осьминог\n";
         wcout << L"5. Кит\n";
         wcout << L"Выберите номер: ";
-        wcin >> choice;
+        EventLoop::instance().readInt(choice);
 
         switch (choice) {
         case 1: return L"Дельфин";
@@ -1906,36 +5956,195 @@ int calculateAnimalPrice(int age, int weight) {
     return max(price, 100);
 }
 
+// Функция генерации животного для магазина.
+// Все характеристики выводятся из зерна, поэтому одинаковое зерно дает одинаковое животное.
+Animal generateShopAnimal(uint32_t seed) {
+    GameRandom rng(seed);
+    Animal newAnimal;
+
+    // Выбор случайного типа и вида (в таблице видов идут по SPECIES_PER_TYPE видов на тип)
+    int typeIndex = rng.range(5);
+    newAnimal.species = 1 + typeIndex * SPECIES_PER_TYPE + rng.range(SPECIES_PER_TYPE);
+    int word = typeIndex * 5 + rng.range(5);
+    newAnimal.name = NameHandle::generated(word, rng.range(1000));
+    newAnimal.isPredator = isPredatorAnimal(newAnimal.specificType());
+
+    // Установка случайного климата
+    newAnimal.climate = static_cast<Climate>(rng.range(3));
+
+    // Установка случайных характеристик
+    newAnimal.age = rng.range(MAX_AGE) + 1;
+    newAnimal.weight = rng.range(400) + 10;
+    newAnimal.isHungry = false;
+    newAnimal.isUnhappy = false;
+    newAnimal.happiness = 70 + rng.range(31); // 70-100
+    newAnimal.female = rng.range(2) != 0;
+    newAnimal.price = calculateAnimalPrice(newAnimal.age, newAnimal.weight);
+    newAnimal.bornInZoo = false;
+    newAnimal.diet = newAnimal.isPredator ? Diet::PREDATORS : Diet::HERBIVORES;
+    newAnimal.state = AnimalState::HEALTHY;
+    newAnimal.genome = Genome::random(rng);
+
+    return newAnimal;
+}
+
 // Функция отображения информации о вольере
-void displayEnclosureInfo(int index, const vector<Enclosure>& enclosures) {
-    if (index >= 0 && index < (int)enclosures.size()) {
-        wcout << L"  Вольер " << index << L": " << enclosures[index].name.c_str() << endl;
-        wcout << L"    Тип животных: " << enclosures[index].animalType << endl;
-        wcout << L"    Конкретный тип: " << (enclosures[index].specificAnimalType.empty() ? L"Любой" : enclosures[index].specificAnimalType) << endl;
-        wcout << L"    Вместимость: " << enclosures[index].capacity << endl;
-        wcout << L"    Климат: ";
-        switch (enclosures[index].climate) {
-        case Climate::CONTINENT: wcout << L"Континент"; break;
-        case Climate::TROPIC: wcout << L"Тропики"; break;
-        case Climate::ARCTIC: wcout << L"Арктика"; break;
-        }
-        wcout << endl;
-        wcout << L"    Для хищников: " << (enclosures[index].isPredatorEnclosure ? L"Да" : L"Нет") << endl;
-        wcout << L"    Для размножения: " << (enclosures[index].isBreedingEnclosure ? L"Да" : L"Нет") << endl;
-        wcout << L"    Животные: ";
-        if (enclosures[index].animals.empty()) {
-            wcout << L"Нет\n";
+void displayEnclosureInfo(int index, const CowVector<Enclosure>& enclosures) {
+    if (index < 0 || index >= (int)enclosures.size()) {
+        wcout << L"Некорректный номер вольера.\n";
+        return;
+    }
+
+    const Enclosure& enclosure = enclosures[index];
+    wostringstream buffer;
+    buffer << L"  Вольер " << index << L": " << enclosure.name << L'\n';
+    buffer << L"    Тип животных: " << enclosure.animalType << L'\n';
+    buffer << L"    Конкретный тип: " << (enclosure.specificAnimalType.empty() ? L"Любой" : enclosure.specificAnimalType) << L'\n';
+    buffer << L"    Вместимость: " << enclosure.capacity << L'\n';
+    buffer << L"    Климат: " << climateName(enclosure.climate) << L'\n';
+    buffer << L"    Для хищников: " << (enclosure.isPredatorEnclosure ? L"Да" : L"Нет") << L'\n';
+    buffer << L"    Для размножения: " << (enclosure.isBreedingEnclosure ? L"Да" : L"Нет") << L'\n';
+    buffer << L"    Животные: ";
+    if (enclosure.animals.empty()) {
+        buffer << L"Нет\n";
+    }
+    else {
+        // Выводится только первая страница имен
+        size_t shown = min(enclosure.animals.size(), (size_t)LIST_PAGE_SIZE);
+        for (size_t i = 0; i < shown; ++i) {
+            buffer << enclosure.animals[i].displayName() << L" ";
         }
-        else {
-            for (const auto& animal : enclosures[index].animals) {
-                wcout << animal.name.c_str() << L" ";
-            }
-            wcout << endl;
+        if (shown < enclosure.animals.size()) {
+            buffer << L"... (всего " << enclosure.animals.size() << L")";
         }
+        buffer << L'\n';
     }
-    else {
-        wcout << L"Некорректный номер вольера.\n";
+    wcout << buffer.str();
+}
+
+// Строка таблицы видов
+struct SpeciesInfo {
+    wstring type; // Общий тип
+    wstring name; // Конкретный вид
+};
+
+// Таблица видов: номер вида - номер строки (0 - вид не задан), виды одного типа идут подряд
+const SpeciesInfo& speciesInfo(int species) {
+    static const SpeciesInfo table[SPECIES_COUNT + 1] = {
+        { L"", L"" },
+        { L"Кошачьи", L"Лев" }, { L"Кошачьи", L"Тигр" }, { L"Кошачьи", L"Леопард" }, { L"Кошачьи", L"Рысь" }, { L"Кошачьи", L"Гепард" },
+        { L"Псовые", L"Собака" }, { L"Псовые", L"Волк" }, { L"Псовые", L"Лиса" }, { L"Псовые", L"Шакал" }, { L"Псовые", L"Гиена" },
+        { L"Птицы", L"Орел" }, { L"Птицы", L"Попугай" }, { L"Птицы", L"Пингвин" }, { L"Птицы", L"Сова" }, { L"Птицы", L"Фламинго" },
+        { L"Пресмыкающиеся", L"Змея" }, { L"Пресмыкающиеся", L"Черепаха" }, { L"Пресмыкающиеся", L"Ящерица" },
+        { L"Пресмыкающиеся", L"Крокодил" }, { L"Пресмыкающиеся", L"Динозавр" },
+        { L"Морские", L"Дельфин" }, { L"Морские", L"Акула" }, { L"Морские", L"Моллюски" }, { L"Морские", L"Осьминог" }, { L"Морские", L"Кит" },
+    };
+    return table[species];
+}
+
+// Функция получения общего типа вида по номеру
+const wstring& speciesType(int species) {
+    return speciesInfo(species).type;
+}
+
+// Функция получения названия вида по номеру
+const wstring& speciesName(int species) {
+    return speciesInfo(species).name;
+}
+
+// Функция получения названия климата
+const wchar_t* climateName(Climate climate) {
+    switch (climate) {
+    case Climate::CONTINENT: return L"Континент";
+    case Climate::TROPIC: return L"Тропики";
+    case Climate::ARCTIC: return L"Арктика";
+    }
+    return L"";
+}
+
+// Функция получения названия состояния животного
+const wchar_t* stateName(AnimalState state) {
+    switch (state) {
+    case AnimalState::HEALTHY: return L"Здоров";
+    case AnimalState::SICK: return L"Болен";
+    case AnimalState::DEAD: return L"Мертв";
+    }
+    return L"";
+}
+
+// Функция получения названия еды для типа питания
+const wchar_t* foodName(Diet diet) {
+    switch (diet) {
+    case Diet::PREDATORS: return L"Мясо";
+    case Diet::HERBIVORES: return L"Растительный корм";
+    }
+    return L"";
+}
+
+// Функция получения названия статьи доходов и расходов
+const wchar_t* ledgerCategoryName(LedgerCategory category) {
+    switch (category) {
+    case LedgerCategory::SALARY: return L"Зарплаты";
+    case LedgerCategory::TICKETS: return L"Билеты";
+    case LedgerCategory::DIRT_PENALTY: return L"Штрафы за грязь";
+    case LedgerCategory::ANIMAL_PURCHASE: return L"Покупка животных";
+    case LedgerCategory::ANIMAL_SALE: return L"Продажа животных";
+    case LedgerCategory::FOOD: return L"Еда";
+    case LedgerCategory::ADVERTISING: return L"Реклама";
+    case LedgerCategory::CONSTRUCTION: return L"Строительство";
+    case LedgerCategory::UPGRADE: return L"Улучшения";
+    case LedgerCategory::ENCLOSURE_SALE: return L"Продажа вольеров";
+    case LedgerCategory::HIRING: return L"Наем";
+    case LedgerCategory::SHOP_REFRESH: return L"Обновление магазина";
+    case LedgerCategory::MARKET: return L"Рынок";
+    case LedgerCategory::UPKEEP: return L"Содержание вольеров";
+    case LedgerCategory::COUNT: break;
+    }
+    return L"";
+}
+
+// Функция получения названия подсистемы для учета памяти
+const wchar_t* memoryTagName(MemoryTag tag) {
+    switch (tag) {
+    case MemoryTag::ANIMALS: return L"Животные";
+    case MemoryTag::ENCLOSURES: return L"Вольеры";
+    case MemoryTag::NAMES: return L"Имена";
+    case MemoryTag::SHOP: return L"Магазин животных";
+    case MemoryTag::LEDGER: return L"Журнал операций";
+    case MemoryTag::OTHER: return L"Прочее";
+    case MemoryTag::COUNT: break;
+    }
+    return L"";
+}
+
+// Функция вывода учета памяти по подсистемам
+void displayMemoryReport() {
+    wostringstream buffer;
+    buffer << L"\n=== Использование памяти ===\n";
+    long long totalLive = 0;
+    for (int t = 0; t < (int)MemoryTag::COUNT; t++) {
+        const MemoryTracker::Counters& counters = MemoryTracker::of((MemoryTag)t);
+        long long live = counters.liveBytes.load(memory_order_relaxed);
+        long long allocations = counters.allocations.load(memory_order_relaxed);
+        if (allocations == 0) continue;
+        totalLive += live;
+        buffer << memoryTagName((MemoryTag)t) << L": " << live / 1024 << L" КБ (пик " << counters.peakBytes.load(memory_order_relaxed) / 1024
+            << L" КБ, выделений " << allocations << L")\n";
+    }
+    buffer << L"Всего учтено: " << totalLive / 1024 << L" КБ\n";
+    wcout << buffer.str();
+}
+
+// Функция получения описания ошибки размножения
+const wchar_t* breedingErrorText(BreedingError error) {
+    switch (error) {
+    case BreedingError::NONE: return L"";
+    case BreedingError::SAME_GENDER: return L"Должен быть разный пол";
+    case BreedingError::TOO_YOUNG: return L"Слишком молодые (возраст должен быть больше 5 дней)";
+    case BreedingError::NO_SPACE: return L"В вольере нет места для потомства";
+    case BreedingError::NO_CONCEPTION: return L"Зачатие не произошло (низкая плодовитость пары)";
     }
+    return L"";
 }
 
 // Функция отображения сообщения о делегации
@@ -1990,6 +6199,18 @@ wstring removeExtraSpaces(const wstring& text) {
     return result;
 }
 
+// Функция разбора целого числа из аргумента командной строки (вся строка должна быть числом из [low, high])
+bool parseNumber(const wstring& text, long long low, long long high, long long& value) {
+    size_t used = 0;
+    try {
+        value = stoll(text, &used);
+    }
+    catch (const exception&) {
+        return false;
+    }
+    return used == text.size() && value >= low && value <= high;
+}
+
 // Главная функция программы
 int wmain(int argc, wchar_t* argv[]) {
     // Настройка консоли для поддержки Unicode
@@ -1997,15 +6218,49 @@ int wmain(int argc, wchar_t* argv[]) {
     _setmode(_fileno(stdin), _O_U16TEXT);
     _setmode(_fileno(stderr), _O_U16TEXT);
 
-    // Инициализация генератора случайных чисел
-    srand((unsigned int)time(nullptr));
+    // Необязательные ключи: --digest (хэш состояния после каждого дня мира)
+    // и --metrics <файл> (периодическая запись метрик в формате Prometheus)
+    vector<wstring> args;
+    bool traceDigest = false;
+    wstring metricsPath;
+    for (int i = 1; i < argc; i++) {
+        wstring arg = argv[i];
+        if (arg == L"--digest") traceDigest = true;
+        else if (arg == L"--metrics" && i + 1 < argc) metricsPath = argv[++i];
+        else args.push_back(arg);
+    }
+    ZooMetrics metrics;
+    unique_ptr<MetricsExporter> exporter;
+    if (!metricsPath.empty()) {
+        exporter = make_unique<MetricsExporter>(metrics, filesystem::path(metricsPath));
+    }
+
+    // Пакетная симуляция мира: ZooGame --world [зоопарков] [дней] [потоков] [зерно]
+    if (!args.empty() && args[0] == L"--world") {
+        // Значения по умолчанию и допустимые границы: зоопарков, дней, потоков, зерно
+        long long values[4] = { 1000, 365, 0, (long long)(uint32_t)time(nullptr) };
+        const long long lows[4] = { 1, 0, 0, 0 };
+        const long long highs[4] = { numeric_limits<int>::max(), numeric_limits<int>::max(), 1024, numeric_limits<uint32_t>::max() };
+        for (size_t i = 1; i < args.size(); i++) {
+            if (i > 4 || !parseNumber(args[i], lows[i - 1], highs[i - 1], values[i - 1])) {
+                wcerr << L"Некорректный аргумент: " << args[i] << endl;
+                wcerr << L"Использование: ZooGame --world [зоопарков] [дней] [потоков] [зерно] [--digest] [--metrics <файл>]" << endl;
+                return 1;
+            }
+        }
+        World world((int)values[0], (uint32_t)values[3], (int)values[2]);
+        int days = (int)values[1];
+        if (exporter) world.metrics = &metrics;
+        world.run(days, traceDigest);
+        exporter.reset(); // Итоговая запись метрик, пока мир еще существует
+        return 0;
+    }
 
     // Приветствие и ввод названия зоопарка
     wcout << L"\n=== Зоопарк Менеджер ===\n";
     wcout << L"Введите название зоопарка: ";
 
-    wstring name;
-    getline(wcin >> ws, name);
+    wstring name = EventLoop::instance().readText();
 
     // Обработка пустого названия
     if (name.empty()) {
@@ -2022,10 +6277,12 @@ int wmain(int argc, wchar_t* argv[]) {
         finalName = L"Мой Зоопарк";
     }
 
-    // Создание зоопарка и запуск игры
-    Zoo zoo(finalName);
+    // Создание зоопарка и запуск игры (случайность только от зерна зоопарка)
+    Zoo zoo(finalName, (uint32_t)time(nullptr));
+    if (exporter) zoo.metrics = &metrics;
     displayDelegationMessage(true);
     zoo.menu();
+    exporter.reset();
 
     return 0;
 }